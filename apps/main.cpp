@@ -0,0 +1,703 @@
+#include "../include/watvis.hpp"
+#include "../include/util/utility.hpp"
+#include "GLFW/glfw3.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+#define WINDOW_TITLE "Water visualization"
+#define DEFAULT_WINDOW_WIDTH 1200
+#define DEFAULT_WINDOW_HEIGHT 800
+#define MIN_WINDOW_WIDTH 800
+#define MIN_WINDOW_HEIGHT 400
+#define HEADLESS_FPS 60.f // Fixed time step of headless frames
+#define BENCHMARK_SEED 3907355480u
+#define BENCHMARK_WARMUP 10 // Frames left out of the benchmark statistics
+#define BENCHMARK_REPORT "./benchmark.json"
+
+// Config
+
+static constexpr float coeffMovement = 79.0f;
+static constexpr float coeffCameraKeyboard = 1.4f;
+static constexpr float coeffCameraMouse = 0.6f;
+
+static constexpr bool disableVsync = false;
+
+// Clipmap: cells per level side, levels, finest cell
+static constexpr int clipmapGrid = 128;
+static constexpr int clipmapLevels = 9;
+static constexpr float clipmapCell = 3.75f;
+
+// Tessellation: patches per side, patch size
+static constexpr int tessPatches = 64;
+static constexpr float tessPatchSize = 480.f;
+
+// Largest displacement of the chunk, culled bounds of chunk patches and tiles are inflated by it
+static constexpr float displacementMargin = 120.f;
+
+
+enum class Renderer {
+    CHUNK,        // WaterMeshChunk, one simulation patch
+    CLIPMAP,      // WaterClipmap
+    TESSELLATION, // WaterTessellation
+    TILES,        // WaterTiles
+};
+
+static WaterMeshChunk::Backend backend = WaterMeshChunk::Backend::GPU;
+static int cpuThreads = 0; // One per hardware thread
+static WaterMeshChunk::Precision precision = WaterMeshChunk::Precision::FULL;
+
+// Headless mode renders a fixed number of frames into an offscreen target
+static long headlessFrames = 0; // 0 - interactive window
+static int headlessWidth = DEFAULT_WINDOW_WIDTH;
+static int headlessHeight = DEFAULT_WINDOW_HEIGHT;
+static std::string headlessOutput = "./headless.png";
+static long warmupFrames = -1; // Rendered but left out of the statistics, -1 - default
+static bool isBenchmark = false;
+static long seed = -1; // -1 - random
+static std::string cameraPathFile;
+static std::string reportPath; // Empty - statistics are only printed
+
+// Flight over the default scene used by --benchmark
+static const std::vector<CameraPath::Key> benchmarkPath = {
+    {  0.f, { 1191.f, 306.f, 1767.f },  84.f, -23.f },
+    {  3.f, { 1500.f, 180.f, 1800.f },  95.f, -15.f },
+    {  6.f, { 1900.f,  60.f, 1900.f }, 130.f,  -5.f },
+    {  9.f, { 2200.f, 120.f, 2300.f }, 200.f, -10.f },
+    { 12.f, { 2000.f, 400.f, 2600.f }, 260.f, -35.f },
+    { 15.f, { 1400.f, 250.f, 2200.f }, 300.f, -20.f },
+};
+
+// States
+
+static Camera cam;
+static double oldmx, oldmy; // Used for looking around using mouse
+
+static bool isMesh = false;
+static bool isCursorHided = false;
+static bool isFreeze = false;
+static bool isSharedFFT = true;
+static bool isSpectralNormals = false;
+static bool isCulling = false; // Chunk patches, tiles are always culled
+static bool isVertexTexture = false;
+static bool isOptionsChanged = true; // The chunk options above are applied on the next frame
+static int gridNodes = 0; // Of the flat grid drawn from the displacement map, 0 - simulation grid
+static GridIndices::Layout indexLayout = GridIndices::Layout::STRIPS;
+static bool shortIndices = true;
+static Renderer renderer = Renderer::CHUNK;
+static int tilesRadius = 2; // (2 * r + 1)^2 tiles
+
+// Prototypes
+
+static bool parseArgs(int argc, char **argv);
+static bool initGraphics(GLFWwindow *&window, bool headless);
+static int run(GLFWwindow *window, bool headless, const RenderTarget &target, int width, int height,
+               const CameraPath &cameraPath);
+
+static void key_callback(GLFWwindow*, int, int, int, int);
+static void mouse_button_callback(GLFWwindow*, int, int, int);
+static void window_size_callback(GLFWwindow*, int, int);
+
+static void move(GLFWwindow *window, float dt);
+static const char* getRendererName(Renderer renderer);
+static void takeScreenshot(int width, int height, const std::string &path);
+
+// Main
+
+int main(int argc, char **argv) {
+    if (!parseArgs(argc, argv)) {
+        return -1;
+    }
+    if (isBenchmark) {
+        if (seed < 0)
+            seed = BENCHMARK_SEED;
+        if (warmupFrames < 0)
+            warmupFrames = BENCHMARK_WARMUP;
+        if (reportPath.empty())
+            reportPath = BENCHMARK_REPORT;
+    }
+    warmupFrames = std::max(warmupFrames, 0l);
+    if (headlessFrames > 0 && warmupFrames >= headlessFrames) {
+        std::cerr << "Warmup of " << warmupFrames << " frames leaves none of " << headlessFrames
+                  << " to measure, using " << headlessFrames - 1 << std::endl;
+        warmupFrames = headlessFrames - 1;
+    }
+
+    CameraPath cameraPath;
+    try {
+        if (!cameraPathFile.empty())
+            cameraPath = CameraPath::load(cameraPathFile);
+        else if (isBenchmark)
+            cameraPath = CameraPath(benchmarkPath);
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    bool headless = headlessFrames > 0;
+    GLFWwindow *window;
+    if (!initGraphics(window, headless)) {
+        return -1;
+    }
+    Shader::setDeferredCompile(true);
+
+    int width, height;
+    RenderTarget target;
+    if (headless) {
+        target = RenderTarget(headlessWidth, headlessHeight);
+        width = headlessWidth;
+        height = headlessHeight;
+        GpuProfiler::get().setEnabled(true);
+    }
+    else
+        glfwGetWindowSize(window, &width, &height);
+
+    // The scene frees its GL objects on return, while the context is alive
+    int status = run(window, headless, target, width, height, cameraPath);
+    glfwTerminate();
+    return status;
+}
+
+static int run(GLFWwindow *window, bool headless, const RenderTarget &target, int width, int height,
+               const CameraPath &cameraPath) {
+    float ratio = (float) width / (float) height;
+
+    cam.setPos(1191, 306, 1767);
+    cam.setViewDeg(84, -23);
+
+    glm::vec3 skyCol = glm::vec3(135, 206, 235) / 255.f * 0.8f;
+
+    EnvSky sky("", glm::vec3(0.5f, 0.5f, 0.0f), 10000.f, 500.f);
+    sky.setSunCol(glm::vec3(255.f, 255.f, 59.f) / 255.f);
+
+    if (seed >= 0)
+        WaterMeshChunk::setSeed(seed);
+    WaterMeshChunk mesh(512, 7.5f, 0, 0, backend);
+    mesh.setThreadCount(cpuThreads);
+    mesh.setPrecision(precision);
+    mesh.setWind({ 1.f, 0.f, 0.2f }, 180.f);
+    mesh.setAmplitude(700.f);
+    mesh.setGlobalAmbient(glm::vec3(0.35f, 0.35f, 0.45f));
+    mesh.setAmbient(glm::vec3(0.02f, 0.07f, 0.10f));
+    mesh.setDiffuse(glm::vec3(0.03f, 0.04f, 0.05f));
+    mesh.setSpecular(glm::vec3(0.13f, 0.25f, 0.40f), 290.f);
+    mesh.setBaseColor(glm::vec3(0.02f, 0.03f, 0.04f), glm::vec3(0.99f, 0.79f, 0.65f));
+
+    mesh.setSky(sky);
+    mesh.setSkyColor(skyCol);
+    mesh.setCullMargin(displacementMargin);
+    if (gridNodes > 0)
+        mesh.setGridNodes(gridNodes);
+    mesh.setIndexLayout(indexLayout, shortIndices);
+
+    // The same simulation tiled up to the horizon. Each is built the first time it is selected,
+    // so a run of the chunk alone compiles none of their programs and uploads none of their buffers
+    WaterClipmap *clipmap = nullptr;
+    WaterTessellation *tessellation = nullptr;
+    WaterTiles *tiles = nullptr;
+    auto initRenderer = [&]() {
+        if (renderer == Renderer::CLIPMAP && !clipmap)
+            clipmap = new WaterClipmap(clipmapGrid, clipmapLevels, clipmapCell);
+        else if (renderer == Renderer::TESSELLATION && !tessellation)
+            tessellation = new WaterTessellation(tessPatches, tessPatchSize);
+        else if (renderer == Renderer::TILES && !tiles)
+            tiles = new WaterTiles(mesh, tilesRadius, displacementMargin);
+    };
+
+    // Every program is submitted before the CPU-side tables are built in update
+    initRenderer();
+    DebugInformer debugger;
+    mesh.update();
+    FrameUniforms frame(FrameData{});
+
+    glClearColor(skyCol.r, skyCol.g, skyCol.b, 1.f);
+    if constexpr (disableVsync)
+        glfwSwapInterval(0);
+
+    float timePhys = glfwGetTime();  // Used for physics, updates every frame
+    float timeFPS = timePhys;        // Used for fps counting, updates every second
+    uint framesCounter = 0;
+    uint fps = 0;
+    bool isFirstFrame = true;
+    long frameIndex = 0;
+    long visiblePatches = 0; // Sums over the measured frames
+    long visibleTiles = 0;
+    BenchmarkReport report; // Headless only
+    int status = 0;
+
+    while (!glfwWindowShouldClose(window)) {
+        double frameStart = glfwGetTime();
+
+        // Time deltas, headless frames are a function of the frame index only
+        float nTime = headless ? frameIndex / HEADLESS_FPS : frameStart;
+        float dt = nTime - timePhys;
+        timePhys = nTime;
+
+        // FPS counting
+        framesCounter++;
+        if (nTime - timeFPS >= 1.0) {
+            fps = framesCounter;
+            framesCounter = 0;
+            timeFPS = nTime;
+        }
+
+        if (headless && frameIndex == warmupFrames) {
+            GpuProfiler::get().flush();
+            GpuProfiler::get().setHistory(true);
+        }
+
+        Tracer::get().beginFrame();
+        GpuProfiler::get().beginFrame();
+        TRACE_SCOPE("frame");
+        GPU_SCOPE("frame");
+        {
+            TRACE_SCOPE("poll events");
+            glfwPollEvents();
+        }
+        if (headless)
+            target.bind();
+        else {
+            glfwGetWindowSize(window, &width, &height);
+            glViewport(0, 0, width, height);
+        }
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        ratio = (float) width / (float) height;
+
+        if (!cameraPath.empty())
+            cam = cameraPath.at(timePhys);
+        else if (!headless) {
+            TRACE_SCOPE("move");
+            move(window, dt);
+        }
+        if (isOptionsChanged) {
+            mesh.setFFTMode(isSharedFFT ? WaterMeshChunk::FFTMode::SHARED : WaterMeshChunk::FFTMode::BUTTERFLY);
+            mesh.setSpectralNormals(isSpectralNormals);
+            mesh.setCulling(isCulling);
+            mesh.setVertexSource(isVertexTexture ? WaterMeshChunk::VertexSource::TEXTURE : WaterMeshChunk::VertexSource::BUFFER);
+            // Rejected options keep the previous state
+            isSharedFFT = mesh.getFFTMode() == WaterMeshChunk::FFTMode::SHARED;
+            isSpectralNormals = mesh.isSpectralNormals();
+            isOptionsChanged = false;
+        }
+        initRenderer();
+        if (!isFreeze) {
+            TRACE_SCOPE("computePhysics");
+            mesh.computePhysics(timePhys);
+        }
+
+        {
+            TRACE_SCOPE("matrices");
+            glm::mat4 m_view1 =
+                glm::scale(glm::mat4(1.f), glm::vec3(0.3, 0.3, 0.3)) *
+                glm::scale(glm::mat4(1.f), glm::vec3(cam.zoom, cam.zoom, 1.f)) *
+                glm::rotate(glm::mat4(1.f), cam.roll, glm::vec3(0, 0, -1)) *
+                glm::rotate(glm::mat4(1.f), cam.pitch, glm::vec3(-1, 0, 0)) *
+                glm::rotate(glm::mat4(1.f), cam.yaw, glm::vec3(0, 1, 0));
+            glm::mat4 m_proj =
+                renderer == Renderer::CLIPMAP ? glm::perspective(45.f, ratio, 1.f, clipmap->getRange()) :
+                renderer == Renderer::TESSELLATION ? glm::perspective(45.f, ratio, 1.f, tessellation->getRange()) :
+                renderer == Renderer::TILES ? glm::perspective(45.f, ratio, 1.f, tiles->getRange(mesh)) :
+                glm::perspective(45.f, ratio, 0.1f, 2500.f);
+            glm::mat4 m_proj_view =
+                m_proj *
+                m_view1 *
+                glm::translate(glm::mat4(1.f), -cam.pos);
+            glm::mat4 m_sun =
+                glm::perspective(45.f, ratio, 100.f, 100000.f) *
+                m_view1;
+            glm::mat4 m_ortho = glm::ortho(0.0f, (float) width, 0.0f, (float) height);
+
+            FrameData &fd = frame.getData();
+            fd.projView = m_proj_view;
+            fd.skyProjView = m_sun;
+            fd.ortho = m_ortho;
+            fd.eye = glm::vec4(cam.pos, 1.f);
+            fd.time = timePhys;
+            fd.viewport = glm::vec4(width, height, 0.5f * height * m_proj[1][1] * cam.zoom, 0.f);
+            frame.upload();
+        }
+
+        {
+            TRACE_SCOPE("draw");
+            sky.show(frame);
+            if (renderer == Renderer::CLIPMAP)
+                clipmap->show(frame, mesh, isMesh);
+            else if (renderer == Renderer::TESSELLATION)
+                tessellation->show(frame, mesh, isMesh);
+            else if (renderer == Renderer::TILES)
+                tiles->show(frame, mesh, isMesh);
+            else
+                mesh.show(frame, isMesh);
+
+            // mesh.showDebugImage(frame, timePhys);
+
+            if (!headless) {
+                debugger.setPos(cam.pos);
+                debugger.setView(cam.yaw, cam.pitch);
+                debugger.setFPS(fps);
+                if (renderer == Renderer::CHUNK)
+                    debugger.setCustomMsg("Patches: " + std::to_string(mesh.getVisiblePatches()) + "/" + std::to_string(mesh.getPatchCount()));
+                else if (renderer == Renderer::TILES)
+                    debugger.setCustomMsg("Tiles: " + std::to_string(tiles->getVisibleTiles()) + "/" + std::to_string(tiles->getTileCount()));
+                else
+                    debugger.setCustomMsg("WatViz");
+                debugger.show(frame, width, height);
+            }
+        }
+
+        if (headless) {
+            // Nothing is presented, so wait for the GPU to time the whole frame
+            double submitted = glfwGetTime();
+            {
+                TRACE_SCOPE("finish");
+                glFinish();
+            }
+            if (frameIndex >= warmupFrames) {
+                report.addCpu("submit", (submitted - frameStart) * 1000.f);
+                report.addCpu("frame", (glfwGetTime() - frameStart) * 1000.f);
+                visiblePatches += mesh.getVisiblePatches();
+                if (renderer == Renderer::TILES)
+                    visibleTiles += tiles->getVisibleTiles();
+            }
+            if (++frameIndex >= headlessFrames)
+                glfwSetWindowShouldClose(window, 1);
+        }
+        else {
+            TRACE_SCOPE("swap buffers");
+            glfwSwapBuffers(window);
+        }
+
+        // Time since glfwInit, mostly shader compilation on a cold shader cache
+        if (isFirstFrame) {
+            std::cout << "Startup: " << formatFloat("%.1f", glfwGetTime() * 1000.f) << " ms" << std::endl;
+            isFirstFrame = false;
+        }
+    }
+
+    if (headless) {
+        target.bind();
+        takeScreenshot(width, height, headlessOutput);
+        RenderTarget::unbind();
+        std::cout << "Last frame saved in " << headlessOutput << std::endl;
+
+        GpuProfiler &profiler = GpuProfiler::get();
+        profiler.flush();
+        for (const GpuProfiler::History &h : profiler.getHistory())
+            report.addGpu(h.name, h.samples);
+
+        long measured = headlessFrames - warmupFrames;
+        report.setInfo("frames", measured);
+        report.setInfo("warmup", warmupFrames);
+        report.setInfo("timestep", 1.f / HEADLESS_FPS);
+        report.setInfo("width", width);
+        report.setInfo("height", height);
+        report.setInfo("backend", backend == WaterMeshChunk::Backend::GPU ? "gpu" : "cpu");
+        report.setInfo("precision", precision == WaterMeshChunk::Precision::FULL ? "full" : "half");
+        report.setInfo("renderer", getRendererName(renderer));
+        if (seed >= 0)
+            report.setInfo("seed", seed);
+        else
+            report.setInfo("seed", "random");
+        report.setInfo("culling", isCulling ? "on" : "off");
+        report.setInfo("vertices", isVertexTexture ? "texture" : "buffer");
+        if (isVertexTexture)
+            report.setInfo("grid nodes", mesh.getGridNodes());
+        report.setInfo("indices", GridIndices::getName(mesh.getIndexLayout()));
+        report.setInfo("index bits", mesh.isShortIndices() ? 16 : 32);
+        if (renderer == Renderer::CHUNK) {
+            report.setInfo("visible patches", (double)visiblePatches / measured);
+            report.setInfo("patches", mesh.getPatchCount());
+        }
+        if (renderer == Renderer::TILES) {
+            double avgTiles = (double)visibleTiles / measured;
+            report.setInfo("visible tiles", avgTiles);
+            report.setInfo("tiles", tiles->getTileCount());
+            report.setInfo("tile vertices", avgTiles * tiles->getVertexCount());
+        }
+        report.setInfo("camera", !cameraPathFile.empty() ? cameraPathFile : isBenchmark ? "builtin" : "fixed");
+        report.print(std::cout);
+        if (!reportPath.empty()) {
+            if (report.write(reportPath))
+                std::cout << "Benchmark report saved in " << reportPath << std::endl;
+            else
+                status = -1;
+        }
+    }
+
+    delete clipmap;
+    delete tessellation;
+    delete tiles;
+    return status;
+}
+
+// Window events
+
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        isCursorHided = !isCursorHided;
+        if (isCursorHided)
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        else
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+
+        double mx, my;
+        glfwGetCursorPos(window, &mx, &my);
+        oldmx = mx;
+        oldmy = my;
+    }
+    else if (key == GLFW_KEY_Q && action == GLFW_PRESS) {
+        isMesh = !isMesh;
+    }
+    else if (key == GLFW_KEY_Z && action == GLFW_PRESS) {
+        isFreeze = !isFreeze;
+    }
+    else if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        isSharedFFT = !isSharedFFT;
+        isOptionsChanged = true;
+        std::cout << "FFT mode: " << (isSharedFFT ? "shared" : "butterfly") << std::endl;
+    }
+    else if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+        isSpectralNormals = !isSpectralNormals;
+        isOptionsChanged = true;
+        std::cout << "Normals: " << (isSpectralNormals ? "spectral" : "finite differences") << std::endl;
+    }
+    else if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        renderer = renderer == Renderer::CHUNK ? Renderer::CLIPMAP :
+                   renderer == Renderer::CLIPMAP ? Renderer::TESSELLATION :
+                   renderer == Renderer::TESSELLATION ? Renderer::TILES : Renderer::CHUNK;
+        std::cout << "Renderer: " << getRendererName(renderer) << std::endl;
+    }
+    else if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        isVertexTexture = !isVertexTexture;
+        isOptionsChanged = true;
+        std::cout << "Chunk vertices: " << (isVertexTexture ? "displacement texture" : "vertex buffer") << std::endl;
+    }
+    else if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+        isCulling = !isCulling;
+        isOptionsChanged = true;
+        std::cout << "Patch culling: " << (isCulling ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        GpuProfiler &profiler = GpuProfiler::get();
+        profiler.setEnabled(!profiler.isEnabled());
+        std::cout << "GPU profiler: " << (profiler.isEnabled() ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        if (!Tracer::get().isBusy()) {
+            Tracer::get().capture(-1, TRACE_KEY_FRAMES);
+            std::cout << "Tracing " << TRACE_KEY_FRAMES << " frames..." << std::endl;
+        }
+    }
+    else if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        std::string path = "./screenshots/screenshot.png";
+        std::cout << "Taking screenshot..." << std::endl;
+        int width, height;
+        glfwGetWindowSize(window, &width, &height);
+        takeScreenshot(width, height, path);
+        std::cout << "Screenshot saved in " << path << std::endl;
+    }
+}
+
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {}
+void window_size_callback(GLFWwindow *window, int width, int height) {}
+
+// Movement
+
+void move(GLFWwindow *window, float dt) {
+    // View
+    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+        cam.yaw = stepYaw(cam.yaw, coeffCameraKeyboard * dt);
+    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+        cam.yaw = stepYaw(cam.yaw, -coeffCameraKeyboard * dt);
+    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+        cam.pitch = stepPitch(cam.pitch, -coeffCameraKeyboard * dt);
+    if (glfwGetKey(window, GLFW_KEY_DOWN)  == GLFW_PRESS)
+        cam.pitch = stepPitch(cam.pitch, coeffCameraKeyboard * dt);
+
+    // Position
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        cam.pos += glm::vec3(-coeffMovement * dt * cam.getMoveDir());
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        cam.pos  += glm::vec3(coeffMovement * dt * cam.getMoveDir());
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        cam.pos  += glm::vec3(-coeffMovement * dt * cam.getLeftDir());
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        cam.pos  += glm::vec3(coeffMovement * dt * cam.getLeftDir());
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
+        cam.pos.y += coeffMovement * dt;
+    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
+        cam.pos.y += -coeffMovement * dt;
+
+    // Mouse
+    double mx, my;
+    glfwGetCursorPos(window, &mx, &my);
+    cam.yaw = stepYaw(cam.yaw, (mx - oldmx) * -coeffCameraMouse * dt);
+    cam.pitch = stepPitch(cam.pitch, (my - oldmy) * coeffCameraMouse * dt);
+    oldmx = mx;
+    oldmy = my;
+}
+
+// Init
+
+bool parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--cpu") {
+            backend = WaterMeshChunk::Backend::CPU;
+        }
+        else if (arg == "--half") {
+            precision = WaterMeshChunk::Precision::HALF;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            cpuThreads = atoi(argv[++i]);
+        }
+        else if (arg == "--trace" && i + 2 < argc) {
+            long first = atol(argv[++i]);
+            long frames = atol(argv[++i]);
+            Tracer::get().capture(first, frames);
+        }
+        else if (arg == "--clipmap") {
+            renderer = Renderer::CLIPMAP;
+        }
+        else if (arg == "--tessellation") {
+            renderer = Renderer::TESSELLATION;
+        }
+        else if (arg == "--tiles" && i + 1 < argc) {
+            renderer = Renderer::TILES;
+            tilesRadius = std::max(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--vertex-texture") {
+            isVertexTexture = true;
+        }
+        else if (arg == "--grid" && i + 1 < argc) {
+            isVertexTexture = true;
+            gridNodes = atoi(argv[++i]);
+        }
+        else if (arg == "--indices" && i + 1 < argc) {
+            std::string layout = argv[++i];
+            if (layout == "rows")
+                indexLayout = GridIndices::Layout::ROWS;
+            else if (layout == "morton")
+                indexLayout = GridIndices::Layout::MORTON;
+            else if (layout == "strips")
+                indexLayout = GridIndices::Layout::STRIPS;
+            else {
+                std::cerr << "Unknown index layout: " << layout << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--long-indices") {
+            shortIndices = false;
+        }
+        else if (arg == "--culling") {
+            isCulling = true;
+        }
+        else if (arg == "--no-shader-cache") {
+            Shader::setBinaryCache(false);
+        }
+        else if (arg == "--headless" && i + 1 < argc) {
+            headlessFrames = atol(argv[++i]);
+        }
+        else if (arg == "--size" && i + 1 < argc
+                 && sscanf(argv[i + 1], "%dx%d", &headlessWidth, &headlessHeight) == 2) {
+            i++;
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            headlessOutput = argv[++i];
+        }
+        else if (arg == "--benchmark" && i + 1 < argc) {
+            headlessFrames = atol(argv[++i]);
+            isBenchmark = true;
+        }
+        else if (arg == "--warmup" && i + 1 < argc) {
+            warmupFrames = atol(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--camera-path" && i + 1 < argc) {
+            cameraPathFile = argv[++i];
+        }
+        else if (arg == "--report" && i + 1 < argc) {
+            reportPath = argv[++i];
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [--cpu] [--threads N] [--half] [--clipmap | --tessellation | --tiles R] [--culling] [--vertex-texture] [--grid N]"
+                      << " [--indices rows|morton|strips] [--long-indices] [--no-shader-cache] [--trace FIRST COUNT]"
+                      << " [--headless FRAMES | --benchmark FRAMES] [--size WxH] [--output PATH]"
+                      << " [--warmup N] [--seed N] [--camera-path FILE] [--report PATH]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool initGraphics(GLFWwindow *&window, bool headless) {
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return false;
+    }
+
+    // The window only provides the context, frames go to a RenderTarget
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    window = glfwCreateWindow(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, WINDOW_TITLE, nullptr, nullptr);
+    if (!window) {
+        std::cerr << "Failed to initialize window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(window);
+    glfwSetWindowSizeLimits(window, MIN_WINDOW_WIDTH, MIN_WINDOW_HEIGHT, GLFW_DONT_CARE, GLFW_DONT_CARE);
+
+    glewExperimental = GL_TRUE;
+    GLenum glewStatus = glewInit();
+    if (glewStatus != GLEW_OK || !GLEW_VERSION_2_1) {
+        std::cerr << "Failed to initialize GLEW" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
+    glfwSetWindowSizeCallback(window, window_size_callback);
+
+    return true;
+}
+
+// Misc
+
+const char* getRendererName(Renderer renderer) {
+    switch (renderer) {
+    case Renderer::CLIPMAP:
+        return "clipmap";
+    case Renderer::TESSELLATION:
+        return "tessellation";
+    case Renderer::TILES:
+        return "tiles";
+    default:
+        return "chunk";
+    }
+}
+
+// Reads the bound framebuffer
+void takeScreenshot(int width, int height, const std::string &path) {
+    GLubyte *buff = new GLubyte[width * height * 3l];
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, buff);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    int ret = ImageRGB::useArray(buff, width, height).writePNG(path);
+    if (ret == 0)
+        std::cerr << "Something went wrong while saving the screenshot!" << std::endl;
+
+    delete[] buff;
+}
@@ -0,0 +1,52 @@
+#include "../include/cpuOcean.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scaling of the CPU backend: frame time for 1..maxThreads threads and several grid sizes.
+// Usage: cpuScaling [maxThreads] [frames]
+
+static constexpr int gridSizes[] = { 256, 512, 1024, 2048 };
+static constexpr float nodeSize = 7.5f;
+
+static double frameMs(CpuOcean &ocean, int frames) {
+    ocean.compute(0.f); // Warm up
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++)
+        ocean.compute(f / 60.f);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+int main(int argc, char **argv) {
+    int maxThreads = argc > 1 ? atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    int frames = argc > 2 ? atoi(argv[2]) : 20;
+
+    std::cout << "N\tthreads\tms/frame\tspeedup" << std::endl;
+    for (int N : gridSizes) {
+        // Timing does not depend on the spectrum shape, random values are enough
+        std::vector<float> h0((size_t)N * N * 4);
+        std::mt19937 gen(1);
+        std::normal_distribution<float> dis;
+        for (auto &v : h0)
+            v = dis(gen);
+
+        CpuOcean ocean(N, nodeSize, 1);
+        ocean.setSpectrum(h0.data());
+        double base = 0.0;
+        for (int t = 1; t <= maxThreads; t++) {
+            ocean.setThreadCount(t);
+            double ms = frameMs(ocean, frames);
+            if (t == 1)
+                base = ms;
+            std::cout << N << "\t" << t << "\t" << ms << "\t" << base / ms << std::endl;
+        }
+    }
+    return 0;
+}
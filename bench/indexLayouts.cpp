@@ -0,0 +1,48 @@
+#include "../include/gridIndices.hpp"
+#include "../include/waterMeshChunk.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+// Index buffer size and post-transform cache efficiency of every GridIndices layout
+// for the chunk grids, with FIFO caches of typical sizes. Does not need GL context.
+// Usage: indexLayouts [maxN]
+
+static constexpr int gridSizes[] = { 128, 256, 512, 1024, 2048, 4096 };
+static constexpr int cacheSizes[] = { 16, 32 };
+static constexpr int border = 4; // As in WaterMeshChunk
+
+int main(int argc, char **argv) {
+    int maxN = argc > 1 ? atoi(argv[1]) : 2048;
+
+    std::cout << "N\tlayout\tbits\tindices\tKiB";
+    for (int c : cacheSizes)
+        std::cout << "\thit" << c << "\tACMR" << c;
+    std::cout << std::endl;
+
+    const GridIndices::Layout layouts[] = {
+        GridIndices::Layout::ROWS, GridIndices::Layout::MORTON, GridIndices::Layout::STRIPS
+    };
+    for (int N : gridSizes) {
+        if (N > maxN)
+            break;
+        for (GridIndices::Layout layout : layouts) {
+            for (bool shortIndices : { false, true }) {
+                GridIndices indices(N, border, CULL_PATCH_CELLS, layout, shortIndices);
+                if (shortIndices && !indices.isShort())
+                    continue;
+                std::cout << N << "\t" << GridIndices::getName(layout) << "\t" << (indices.isShort() ? 16 : 32)
+                          << "\t" << indices.getCount() << "\t" << indices.getSize() / 1024;
+                for (int c : cacheSizes) {
+                    GridIndices::CacheStats stats = indices.simulateCache(c);
+                    char buff[64];
+                    snprintf(buff, sizeof(buff), "\t%.3f\t%.3f", stats.getHitRate(), stats.getACMR());
+                    std::cout << buff;
+                }
+                std::cout << std::endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include "../include/util/glew.hpp"
+#include "GLFW/glfw3.h"
+
+#include "../include/waterMeshChunk.hpp"
+#include "../include/util/gpuProfiler.hpp"
+#include "../include/util/benchmarkReport.hpp"
+#include "../include/util/utility.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Stages of the ocean simulation one by one for every grid size, backend, precision
+// and FFT mode, results go to JSON tagged with the commit for a performance history.
+// Usage: kernelBench [--sizes 64,256,...] [--frames F] [--output PATH]
+// Run from the project root, shaders are loaded from ./shaders.
+
+#ifndef WATVIS_GIT_REV
+#define WATVIS_GIT_REV "unknown"
+#endif
+
+static constexpr int gridSizes[] = { 64, 128, 256, 512, 1024, 2048, 4096 };
+static constexpr float nodeSize = 7.5f;
+
+struct Result {
+    int N;
+    std::string backend, precision, fft, stage;
+    BenchmarkReport::Summary summary;
+};
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class KernelBench {
+private:
+    int frames;
+    std::vector<Result> results;
+
+    void add(const WaterMeshChunk &mesh, const std::string &stage, const std::vector<float> &samples) {
+        Result r;
+        bool cpu = mesh.getBackend() == WaterMeshChunk::Backend::CPU;
+        r.N = mesh.getWidth();
+        r.backend = cpu ? "cpu" : "gpu";
+        r.precision = cpu ? "-" : mesh.getPrecision() == WaterMeshChunk::Precision::FULL ? "full" : "half";
+        r.fft = cpu ? "-" : mesh.getFFTMode() == WaterMeshChunk::FFTMode::SHARED ? "shared" : "butterfly";
+        r.stage = stage;
+        r.summary = BenchmarkReport::summarize(samples);
+        results.push_back(r);
+
+        std::cout << std::left << std::setw(6) << r.N << std::setw(5) << r.backend
+                  << std::setw(6) << r.precision << std::setw(11) << r.fft
+                  << std::setw(11) << r.stage << std::right
+                  << " p50 " << formatFloat("%8.3f", r.summary.p50)
+                  << "  p95 " << formatFloat("%8.3f", r.summary.p95)
+                  << "  min " << formatFloat("%8.3f", r.summary.min) << " ms" << std::endl;
+    }
+
+    // update rebuilds the h0 and butterfly tables on the CPU and uploads them, finished on the GPU
+    void benchTables(WaterMeshChunk &mesh) {
+        std::vector<float> tablesMs;
+        for (int f = 0; f < frames; f++) {
+            double start = nowMs();
+            mesh.update();
+            glFinish();
+            tablesMs.push_back(nowMs() - start);
+        }
+        add(mesh, "tables", tablesMs);
+    }
+
+    // Whole computePhysics until the GPU is done, its passes from the profiler scopes
+    void benchPhysics(const WaterMeshChunk &mesh) {
+        GpuProfiler &profiler = GpuProfiler::get();
+        mesh.computePhysics(0.f); // Programs are linked on the first use
+        profiler.flush();
+        profiler.setHistory(true);
+
+        std::vector<float> totalMs;
+        for (int f = 0; f < frames; f++) {
+            profiler.beginFrame();
+            double start = nowMs();
+            mesh.computePhysics(f / 60.f);
+            glFinish();
+            totalMs.push_back(nowMs() - start);
+        }
+        profiler.flush();
+
+        add(mesh, "physics", totalMs);
+        for (const GpuProfiler::History &h : profiler.getHistory())
+            add(mesh, h.name, h.samples);
+        profiler.setHistory(false);
+    }
+
+public:
+    KernelBench(int frames) : frames(frames) {}
+
+    void run(int N, WaterMeshChunk::Backend backend, WaterMeshChunk::Precision precision,
+             WaterMeshChunk::FFTMode fftMode) {
+        WaterMeshChunk mesh(N, nodeSize, 0, 0, backend);
+        mesh.setPrecision(precision);
+        mesh.setWind({ 1.f, 0.f, 0.2f }, 180.f);
+        mesh.setAmplitude(700.f);
+        mesh.setFFTMode(fftMode);
+        mesh.update();
+
+        benchTables(mesh);
+        benchPhysics(mesh);
+    }
+
+    bool write(const std::string &path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Cannot write results to " << path << std::endl;
+            return false;
+        }
+
+        std::time_t now = std::time(nullptr);
+        char date[32];
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        out << std::fixed << std::setprecision(4);
+        out << "{\n  \"rev\": \"" << WATVIS_GIT_REV << "\",\n  \"date\": \"" << date << "\","
+            << "\n  \"renderer\": \"" << glGetString(GL_RENDERER) << "\","
+            << "\n  \"frames\": " << frames << ",\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            const BenchmarkReport::Summary &s = r.summary;
+            out << (i ? ",\n    " : "\n    ")
+                << "{\"n\": " << r.N << ", \"backend\": \"" << r.backend
+                << "\", \"precision\": \"" << r.precision << "\", \"fft\": \"" << r.fft
+                << "\", \"stage\": \"" << r.stage << "\", \"count\": " << s.count
+                << ", \"min\": " << s.min << ", \"avg\": " << s.avg << ", \"p50\": " << s.p50
+                << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}";
+        }
+        out << "\n  ]\n}\n";
+        return true;
+    }
+};
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes(std::begin(gridSizes), std::end(gridSizes));
+    int frames = 20;
+    std::string output = "./kernelBench.json";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            std::stringstream ss(argv[++i]);
+            std::string n;
+            while (std::getline(ss, n, ','))
+                sizes.push_back(atoi(n.c_str()));
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--sizes 64,256,...] [--frames F] [--output PATH]" << std::endl;
+            return -1;
+        }
+    }
+
+    // The window only provides the context
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "kernelBench", nullptr, nullptr);
+    if (!window) {
+        std::cerr << "Failed to initialize window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        std::cerr << "Failed to initialize GLEW" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    GpuProfiler::get().setEnabled(true);
+    WaterMeshChunk::setSeed(1);
+
+    KernelBench bench(frames);
+    for (int N : sizes) {
+        if (N < 16 || (N & (N - 1)) != 0) {
+            std::cerr << "Skipping N = " << N << ", not a power of two >= 16" << std::endl;
+            continue;
+        }
+        for (auto precision : { WaterMeshChunk::Precision::FULL, WaterMeshChunk::Precision::HALF }) {
+            bench.run(N, WaterMeshChunk::Backend::GPU, precision, WaterMeshChunk::FFTMode::BUTTERFLY);
+            if (N <= FFT_MAX_N)
+                bench.run(N, WaterMeshChunk::Backend::GPU, precision, WaterMeshChunk::FFTMode::SHARED);
+        }
+        bench.run(N, WaterMeshChunk::Backend::CPU, WaterMeshChunk::Precision::FULL,
+                  WaterMeshChunk::FFTMode::BUTTERFLY);
+    }
+
+    bool ok = bench.write(output);
+    if (ok)
+        std::cout << "Results saved in " << output << std::endl;
+    glfwTerminate();
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,56 @@
+#ifndef __CPU_OCEAN_H__
+#define __CPU_OCEAN_H__
+
+#include "util/taskPool.hpp"
+#include <vector>
+
+// CPU version of the simulation in WaterMeshChunk, does not need GL context.
+// Produces vertices and normals in the same layout as the VBO and normal map.
+class CpuOcean {
+private:
+    int nodes, logN;
+    float size;
+
+    // Spectrum, structure-of-arrays: h0(k), conj(h0(-k)), k / |k|, w(k)
+    std::vector<float> h0Re, h0Im, h0cRe, h0cIm;
+    std::vector<float> kxn, kzn, omega;
+
+    // Channels: 0 - dx + i * dz, 1 - dy. Rows are stride floats apart.
+    size_t stride;
+    std::vector<float> re[2], im[2];
+    std::vector<float> tre[2], tim[2]; // Transposed
+    std::vector<float> twRe, twIm;
+    std::vector<int> rev;
+
+    std::vector<float> px, py, pz;
+    std::vector<float> vertices, normals;
+    std::vector<float> displacement; // Vertex minus its grid node
+
+    // Passes are split into cache-sized tiles: column strips for FFT, row blocks otherwise
+    TaskPool pool;
+    int stripWidth, rowGrain;
+
+    void evalSpectrum(float time, int z0, int z1);
+    void fftStrip(float *sre, float *sim, int width) const;
+    void transpose(const float *src, float *dst, int z0, int z1) const;
+    void fftPass(std::vector<float> *sre, std::vector<float> *sim);
+    void computePositions(int z0, int z1);
+    void computeNormals(int z0, int z1);
+
+public:
+    // threads <= 0 - one per hardware thread
+    CpuOcean(int nodes, float size, int threads = 0);
+
+    // h0 in the layout of the h0 texture: RGBA per node
+    void setSpectrum(const float *h0);
+    void compute(float time);
+
+    void setThreadCount(int threads);
+    int getThreadCount() const;
+
+    const float* getVertices() const; // xyz per node
+    const float* getNormals() const;  // Normal and Jacobian per node
+    const float* getDisplacement() const; // xyz per node, periodic
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "util/utility.hpp"
 #include "util/shader.hpp"
 #include "util/font.hpp"
+#include "frameData.hpp"
 
 class DebugInformer {
 private:
@@ -20,7 +21,7 @@ public:
     DebugInformer();
     ~DebugInformer();
 
-    void show(const glm::mat4 &m_ortho, float width, float height) const;
+    void show(const FrameUniforms &frame, float width, float height) const;
 
     void setPos(const glm::vec3 &pos);
     void setPos(float x, float y, float z);
@@ -7,11 +7,20 @@
 #include <glm/mat4x4.hpp>
 
 #include "util/shader.hpp"
+#include "util/uniformBuffer.hpp"
+#include "frameData.hpp"
 #include <string>
 
 class EnvSky {
 private:
+    // std140 layout of the Sun block
+    struct SunMaterial {
+        glm::vec3 color;
+        float pad;
+    };
+
     Shader sunShader;
+    UniformBuffer<SunMaterial> material;
     GLuint vbo, vao;
 
     int corners = 20;
@@ -25,7 +34,7 @@ public:
     EnvSky() = default;
     EnvSky(const std::string &envMap, const glm::vec3 &_sunDir, float sunDist, float sunRadius);
     
-    void show(const glm::mat4 &m_proj_view) const;
+    void show(const FrameUniforms &frame) const;
 
     void setSunCol(const glm::vec3 &col);
     
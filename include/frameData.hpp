@@ -0,0 +1,26 @@
+#ifndef __FRAME_DATA_H__
+#define __FRAME_DATA_H__
+
+#include "util/uniformBuffer.hpp"
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+// Binding points of the uniform blocks, the same in all shaders
+#define FRAME_UBO_BINDING 0
+#define MATERIAL_UBO_BINDING 1
+
+// std140 layout of the Frame block, uploaded once per frame
+struct FrameData {
+    glm::mat4 projView;    // Scene camera
+    glm::mat4 skyProjView; // Scene camera without translation
+    glm::mat4 ortho;       // Window coordinates
+    glm::vec4 eye;         // Camera position in xyz
+    float time;
+    float pad[3];
+    glm::vec4 viewport;    // Width, height, pixels per world unit at distance 1
+};
+static_assert(sizeof(FrameData) == 240, "FrameData must match the std140 Frame block");
+
+typedef UniformBuffer<FrameData> FrameUniforms;
+
+#endif
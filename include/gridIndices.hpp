@@ -0,0 +1,67 @@
+#ifndef __GRID_INDICES_H__
+#define __GRID_INDICES_H__
+
+#include "util/glew.hpp"
+
+#include <vector>
+
+#define GRID_STRIP_CELLS 6 // Width of the column bands of Layout::STRIPS
+
+// Index buffer of an n x n grid of row-major vertices, cut into square patches of patchCells cells.
+// Indices of a patch are contiguous and relative to its first vertex, which is the baseVertex of its draw.
+// They keep the grid row stride n, so 16-bit indices fit while patchCells * (n + 1) is below the restart
+// index: up to n = 2046 for 32-cell patches, so 2048 and larger grids need 32-bit. Does not need GL context.
+class GridIndices {
+public:
+    enum class Layout {
+        ROWS,    // Triangle list, cells row by row
+        MORTON,  // Triangle list, cells in Morton (Z) order
+        STRIPS,  // Triangle strips along the rows of GRID_STRIP_CELLS wide bands, primitive restart between them
+    };
+
+    struct Patch {
+        GLuint firstIndex, count;
+        GLint baseVertex;
+        GLint nodes[4]; // x0, z0, x1, z1, inclusive
+    };
+
+    // Vertex shader invocations of a FIFO post-transform cache
+    struct CacheStats {
+        size_t references, misses, triangles;
+        double getHitRate() const;
+        double getACMR() const; // Misses per triangle
+    };
+
+private:
+    int n;
+    Layout layout;
+    bool shortIndices;
+    std::vector<GLushort> shorts;
+    std::vector<GLuint> ints;
+    std::vector<Patch> patches;
+
+    template<class T>
+    void build(std::vector<T> &out, int border, int patchCells);
+    template<class T>
+    CacheStats simulate(const std::vector<T> &in, int cacheSize) const;
+
+public:
+    // Cells closer than border to the edge of the grid are left out. 16-bit indices are used
+    // when requested and the largest patch fits them. The restart index is the largest value of the type.
+    GridIndices(int n, int border, int patchCells, Layout layout, bool shortIndices);
+
+    GLenum getMode() const;
+    GLenum getType() const;
+    const void* getData() const;
+    size_t getCount() const; // Including restart indices
+    size_t getSize() const;  // Bytes
+    const std::vector<Patch>& getPatches() const;
+    Layout getLayout() const;
+    bool isShort() const;
+
+    CacheStats simulateCache(int cacheSize) const;
+
+    static const char* getName(Layout layout);
+};
+
+#endif
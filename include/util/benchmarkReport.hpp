@@ -0,0 +1,50 @@
+#ifndef __BENCHMARK_REPORT_H__
+#define __BENCHMARK_REPORT_H__
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-frame timings of a run, summarized into percentiles and written as JSON
+// that can be diffed between builds
+class BenchmarkReport {
+public:
+    struct Summary {
+        size_t count;
+        float min, avg, p50, p95, p99, max;
+    };
+
+private:
+    struct Series {
+        std::string name;
+        std::vector<float> samples; // ms
+    };
+
+    // Run parameters, numbers are written unquoted
+    struct Info {
+        std::string key, value;
+        bool number;
+    };
+
+    std::vector<Info> info;
+    std::vector<Series> cpu, gpu;
+
+    static void addTo(std::vector<Series> &series, const std::string &name, float ms);
+    void setInfo(const std::string &key, const std::string &value, bool number);
+
+public:
+    // Nearest-rank percentiles
+    static Summary summarize(std::vector<float> samples);
+
+    void setInfo(const std::string &key, const std::string &value);
+    void setInfo(const std::string &key, const char *value);
+    // Integers are written without the fraction
+    void setInfo(const std::string &key, double value);
+    void addCpu(const std::string &name, float ms);
+    void addGpu(const std::string &name, const std::vector<float> &samples);
+
+    void print(std::ostream &os) const;
+    bool write(const std::string &path) const;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __CAMERA_PATH_H__
+#define __CAMERA_PATH_H__
+
+#include "camera.hpp"
+
+#include <string>
+#include <vector>
+
+// Camera flight through keyframes along a Catmull-Rom spline
+class CameraPath {
+public:
+    struct Key {
+        float time; // s
+        glm::vec3 pos;
+        float yaw, pitch; // deg, not wrapped so a turn can pass 360
+    };
+
+private:
+    std::vector<Key> keys; // By time
+
+public:
+    CameraPath() = default;
+    explicit CameraPath(const std::vector<Key> &keys);
+
+    // Text file, one "time x y z yaw pitch" key per line, # starts a comment
+    static CameraPath load(const std::string &path);
+
+    bool empty() const;
+    float getDuration() const;
+    // Clamped to the first and the last key
+    Camera at(float time) const;
+};
+
+#endif
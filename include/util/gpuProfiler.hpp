@@ -0,0 +1,96 @@
+#ifndef __GPU_PROFILER_H__
+#define __GPU_PROFILER_H__
+
+#include "glew.hpp"
+
+#include <string>
+#include <vector>
+
+#define GPU_PROFILER_FRAMES 4  // Frames in flight, results are read this many frames later
+#define GPU_PROFILER_WINDOW 64 // Samples per scope in the rolling statistics
+
+// Per-pass GPU times from GL_TIMESTAMP queries. Every frame has its own set of
+// queries in a ring, so results are read back only when they are already available.
+// Disabled by default, then a scope only checks a flag.
+class GpuProfiler {
+public:
+    // Milliseconds over the last GPU_PROFILER_WINDOW frames
+    struct Stats {
+        std::string name;
+        float last, min, avg, max;
+    };
+
+    // Every sample of a scope since setHistory(true), ms
+    struct History {
+        std::string name;
+        std::vector<float> samples;
+    };
+
+private:
+    struct Record {
+        int scope;
+        GLuint begin, end;
+    };
+
+    struct Frame {
+        std::vector<GLuint> queries;
+        std::vector<Record> records;
+        size_t used = 0;
+        bool traced = false; // Recorded while Tracer was capturing
+    };
+
+    struct Scope {
+        const char *name; // Literal from GPU_SCOPE, also used by Tracer
+        float samples[GPU_PROFILER_WINDOW];
+        int count = 0, head = 0;
+        std::vector<float> history;
+    };
+
+    bool enabled = false;
+    bool keepHistory = false;
+    Frame frames[GPU_PROFILER_FRAMES];
+    int current = 0;
+    std::vector<Scope> scopes; // In order of the first appearance
+    std::vector<int> open;     // Records of the unfinished scopes
+
+    GpuProfiler() = default;
+
+    GLuint nextQuery();
+    int getScope(const char *name);
+    void collect(Frame &frame);
+
+public:
+    static GpuProfiler& get();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    // Keeps all samples for offline statistics, clears the old ones
+    void setHistory(bool keep);
+
+    // Call once per frame before any scope
+    void beginFrame();
+    // Scopes may nest, a name used several times in a frame is summed
+    void begin(const char *name);
+    void end();
+    // Waits for the frames in flight and adds them to the statistics
+    void flush();
+
+    std::vector<Stats> getStats() const;
+    std::vector<History> getHistory() const;
+};
+
+class GpuScope {
+public:
+    GpuScope(const char *name) { GpuProfiler::get().begin(name); }
+    ~GpuScope() { GpuProfiler::get().end(); }
+};
+
+#define GPU_SCOPE_CONCAT_(a, b) a##b
+#define GPU_SCOPE_CONCAT(a, b) GPU_SCOPE_CONCAT_(a, b)
+// Times the rest of the enclosing block
+#define GPU_SCOPE(name) GpuScope GPU_SCOPE_CONCAT(gpuScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef __RENDER_TARGET_H__
+#define __RENDER_TARGET_H__
+
+#include "glew.hpp"
+
+// Offscreen framebuffer with an RGBA8 color texture and a depth buffer.
+// Like Shader, copies share the same GL objects.
+class RenderTarget {
+private:
+    int width = 0, height = 0;
+    GLuint fbo = 0, colorTex = 0, depthRbo = 0;
+
+public:
+    RenderTarget() = default;
+    RenderTarget(int width, int height);
+
+    // Draws go to this target, the viewport covers all of it
+    void bind() const;
+    // Back to the window framebuffer
+    static void unbind();
+
+    int getWidth() const;
+    int getHeight() const;
+    GLuint getColorTexture() const;
+};
+
+#endif
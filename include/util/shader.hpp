@@ -5,6 +5,9 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
+#include <memory>
 #include <exception>
 
 #include <glm/vec2.hpp>
@@ -12,6 +15,30 @@
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 
+// Uniform location resolved once. The program must be in use when it is set,
+// an invalid handle (-1) is ignored by GL.
+template<class T>
+class Uniform {
+private:
+    GLint location;
+
+public:
+    Uniform(GLint location = -1) : location(location) {}
+
+    bool isValid() const { return location >= 0; }
+    GLint getLocation() const { return location; }
+    void set(const T &val) const;
+};
+
+template<> void Uniform<bool>::set(const bool &val) const;
+template<> void Uniform<GLint>::set(const GLint &val) const;
+template<> void Uniform<GLfloat>::set(const GLfloat &val) const;
+template<> void Uniform<glm::vec2>::set(const glm::vec2 &val) const;
+template<> void Uniform<glm::ivec2>::set(const glm::ivec2 &val) const;
+template<> void Uniform<glm::vec3>::set(const glm::vec3 &val) const;
+template<> void Uniform<glm::vec4>::set(const glm::vec4 &val) const;
+template<> void Uniform<glm::mat4>::set(const glm::mat4 &val) const;
+
 class Shader {
 private:
     enum class ShaderType {
@@ -24,20 +51,64 @@ private:
     };
     friend std::string getShaderTypeName(ShaderType type);
 
+    struct Stage {
+        ShaderType type;
+        std::string path;
+        std::string source; // With defines inserted
+    };
+
+    // Submitted program whose statuses are not checked yet
+    struct Pending {
+        std::vector<Stage> stages;
+        std::vector<GLuint> shaderIds;
+        std::string cachePath; // Empty if the binary is not cached
+        bool done = false;
+    };
+
+    static bool binaryCache;
+    static bool deferredCompile;
+
     bool initialized = false;
     GLuint programId;
+    std::shared_ptr<Pending> pending; // Shared by copies, finished once
 
-    GLuint compileShader(ShaderType type, const std::string &path) const;
-    void linkProgram(GLuint programId) const;
+    mutable std::map<std::string, GLint> uniforms; // Active uniforms, resolved after linking
+    mutable std::set<std::string> reported; // Unknown names, each is reported once
+    mutable bool uniformsCached = false;
+
+    GLuint compileShader(const Stage &stage) const;
+    void checkShader(GLuint shaderId, const Stage &stage) const;
+    void checkProgram() const;
+    void buildProgram(const std::vector<Stage> &stages);
+    void finish() const;
+    bool loadBinary(const std::string &path);
+    void saveBinary(const std::string &path) const;
+    void cacheUniforms() const;
+    GLint getUniformLocation(const std::string &name) const;
 
 public:
     Shader();
-    Shader(const std::string &computePath);
+    // Defines are inserted right after #version, #include "file" is expanded in every stage
+    Shader(const std::string &computePath, const std::map<std::string, std::string> &defines = {});
     Shader(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath = "");
+    // Tessellated program, stages in the pipeline order
+    Shader(const std::string &vertexPath, const std::string &tessControlPath,
+           const std::string &tessEvalPath, const std::string &fragmentPath);
+
+    // Linked programs are stored in SHADER_CACHE_DIR, keyed by sources and driver
+    static void setBinaryCache(bool enabled);
+    // Compile and link errors are reported on the first use instead of in the constructor,
+    // with GL_KHR_parallel_shader_compile the driver compiles in its own threads meanwhile
+    static void setDeferredCompile(bool enabled);
 
     void use() const;
     GLuint getProgramId() const;
 
+    template<class T>
+    Uniform<T> getUniform(const std::string &name) const {
+        return Uniform<T>(getUniformLocation(name));
+    }
+
     void setUniform(const std::string &name, bool val) const;
     void setUniform(const std::string &name, GLint val) const;
     void setUniform(const std::string &name, GLfloat val) const;
@@ -0,0 +1,67 @@
+#ifndef __TASK_POOL_H__
+#define __TASK_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join pool with per-thread deques and work stealing.
+// The calling thread takes part in the work, so one thread means no workers.
+class TaskPool {
+public:
+    typedef std::function<void(int, int)> RangeFunc;
+
+private:
+    struct Task {
+        const RangeFunc *func;
+        int begin, end, grain;
+    };
+
+    // Owner pops from the back, thieves take from the front
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<Queue*> queues;
+    std::atomic<int> remaining;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+    unsigned generation;
+    bool stop;
+
+    void startWorkers(int threads);
+    void stopWorkers();
+    void workerLoop(int index, unsigned seen);
+
+    void push(int index, const Task &task);
+    bool pop(int index, Task &task);
+    bool steal(int index, Task &task);
+    void execute(int index, Task task);
+    void runUntilDone(int index);
+
+public:
+    // threads <= 0 - one per hardware thread
+    TaskPool(int threads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // Must not be called while parallelFor is running
+    void setThreadCount(int threads);
+    int getThreadCount() const;
+
+    // Calls func(begin, end) on disjoint ranges covering [0; count), returns when all are done.
+    // Ranges are split in halves down to grain items, idle threads steal the larger halves.
+    // Nested calls from inside func run serially.
+    void parallelFor(int count, int grain, const RangeFunc &func);
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef __TRACER_H__
+#define __TRACER_H__
+
+#include "glew.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#define TRACE_CAPACITY (1 << 16) // Events per capture, the rest is dropped
+#define TRACE_KEY_FRAMES 60      // Length of a capture started by a key
+
+// Captures CPU scopes and GpuProfiler scopes of a frame range on one clock
+// and writes them as Chrome trace_event JSON (chrome://tracing, Perfetto).
+// Events go to a preallocated buffer through an atomic counter, so scopes
+// can be recorded from any thread without locks.
+class Tracer {
+private:
+    enum class State {
+        IDLE,
+        WAITING,   // Until the first frame of the range
+        RECORDING,
+        DRAINING,  // GPU results of the last frames are still in flight
+    };
+
+    struct Event {
+        const char *name;
+        bool gpu;
+        int64_t begin, end; // ns on the CPU clock
+    };
+
+    Event *events;
+    std::atomic<size_t> count;
+    std::atomic<bool> recording;
+
+    State state = State::IDLE;
+    long frame = 0;
+    long firstFrame, endFrame;
+    int drainFrames;
+    int64_t startTime;
+    int64_t gpuOffset; // CPU clock - GL_TIMESTAMP
+    bool profilerWasEnabled;
+    std::string path;
+
+    Tracer();
+    ~Tracer();
+
+    void start();
+    void write() const;
+
+public:
+    static Tracer& get();
+    // ns since an arbitrary point, the clock of all events
+    static int64_t now();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Records frames [first; first + frames), first is counted by beginFrame.
+    // first < 0 - starts with the next frame.
+    void capture(long first, long frames, const std::string &path = "./trace.json");
+    bool isBusy() const;
+
+    // Call once per frame before GpuProfiler::beginFrame
+    void beginFrame();
+
+    bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+    void cpuEvent(const char *name, int64_t begin, int64_t end);
+    void gpuEvent(const char *name, GLuint64 begin, GLuint64 end);
+};
+
+// Times the rest of the enclosing block on the CPU, name must outlive the capture
+class TraceScope {
+private:
+    const char *name;
+    int64_t begin;
+
+public:
+    TraceScope(const char *name) : name(name) {
+        begin = Tracer::get().isRecording() ? Tracer::now() : -1;
+    }
+    ~TraceScope() {
+        if (begin >= 0 && Tracer::get().isRecording())
+            Tracer::get().cpuEvent(name, begin, Tracer::now());
+    }
+};
+
+#define TRACE_SCOPE_CONCAT_(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_SCOPE_CONCAT(traceScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __UNIFORM_BUFFER_H__
+#define __UNIFORM_BUFFER_H__
+
+#include "glew.hpp"
+
+// Uniform block backed by a buffer object, T must follow the std140 layout of the block.
+// Like Shader, copies share the same GL object.
+template<class T>
+class UniformBuffer {
+private:
+    GLuint ubo = 0;
+    T data;
+
+public:
+    UniformBuffer() = default;
+
+    explicit UniformBuffer(const T &data) : data(data) {
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &this->data, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    T& getData() {
+        return data;
+    }
+
+    const T& getData() const {
+        return data;
+    }
+
+    // Sends changes made through getData
+    void upload() const {
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void bind(GLuint binding) const {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, ubo, 0, sizeof(T));
+    }
+};
+
+#endif
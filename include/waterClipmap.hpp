@@ -0,0 +1,44 @@
+#ifndef __WATER_CLIPMAP_H__
+#define __WATER_CLIPMAP_H__
+
+#include "util/glew.hpp"
+#include "GLFW/glfw3.h"
+
+#include "util/shader.hpp"
+#include "frameData.hpp"
+#include "waterMeshChunk.hpp"
+
+// Nested square rings centred on the camera, each level has twice the cell of the previous one.
+// All levels tile the periodic displacement and normal maps of one WaterMeshChunk,
+// odd vertices slide onto the coarser grid near the outer edge of a level, so levels meet without cracks.
+// Like Shader, copies share the same GL objects.
+class WaterClipmap {
+private:
+    // Index range of one level mesh in the EBO
+    struct Range {
+        GLsizei count = 0;
+        size_t offset = 0;
+    };
+
+    int gridSize;   // Cells per level side, a multiple of 4
+    int levels;
+    float cellSize; // Of the finest level
+
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    GLuint sampler = 0; // Repeat and mipmaps over the textures of the chunk
+    Range full;         // Finest level
+    Range rings[4];     // By the hole offset of the finer level, x + 2 * z
+    Shader shader;
+
+public:
+    WaterClipmap() = default;
+    WaterClipmap(int gridSize, int levels, float cellSize);
+
+    void show(const FrameUniforms &frame, const WaterMeshChunk &water, bool isMesh) const;
+
+    // Distance from the camera to the edge of the coarsest level
+    float getRange() const;
+    int getVertexCount() const;
+};
+
+#endif
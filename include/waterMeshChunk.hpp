@@ -7,73 +7,225 @@
 #include <glm/mat4x4.hpp>
 
 #include "util/shader.hpp"
-#include "util/camera.hpp"
+#include "util/uniformBuffer.hpp"
+#include "frameData.hpp"
 #include "envSky.hpp"
+#include "cpuOcean.hpp"
+#include "gridIndices.hpp"
 
 #include <vector>
+#include <map>
+#include <tuple>
 #include <initializer_list>
 #include <random>
 #include <complex>
 
+#define FFT_MAX_N 2048 // Largest line of fft.comp that fits the shared memory
+#define CULL_PATCH_CELLS 32 // Side of a culled patch in grid cells
+#define CULL_STATS_FRAMES 4 // Visible patch counts are read this many frames later
+#define CULL_WG_SIZE 64     // Patches per work group of cull.comp
+#define CULL_MARGIN 120.f   // Default bound of the displacement, ~96 in the default scene
+
 class WaterMeshChunk {
+public:
+    enum class Backend {
+        GPU,  // Compute shaders, needs GL 4.3
+        CPU,  // CpuOcean, results are uploaded every frame
+    };
+
+    enum class FFTMode {
+        BUTTERFLY,  // One dispatch per stage, ping-pong through ppTex
+        SHARED,     // One dispatch per axis, all stages in shared memory
+    };
+
+    enum class Precision {
+        FULL,  // RG32F simulation textures
+        HALF,  // RG16F, half the memory and bandwidth of every FFT pass
+    };
+
+    enum class VertexSource {
+        BUFFER,   // The simulation writes positions into the VBO, one vertex per node
+        TEXTURE,  // Static flat grid of any resolution displaced from the displacement map
+    };
+
 private:
     int nodes;
     float size;
     glm::vec3 offset;
 
-    int elementsCount;
+    // std430 layout of a patch in cull.comp, its elements are contiguous in the EBO
+    struct Patch {
+        GLuint firstIndex, count;
+        GLuint pad[2];
+        GLint nodes[4]; // x0, z0, x1, z1, inclusive
+    };
+
+    // Matches DrawElementsIndirectCommand
+    struct DrawCommand {
+        GLuint count, instanceCount, firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    bool culling;
+    float cullMargin;
+    int patchCount;
+    GLuint patchBuffer, commandBuffer;
+    GLuint visibleCounters[CULL_STATS_FRAMES]; // Ring, one per frame in flight
+    mutable int cullFrame = 0;
+    mutable int visiblePatches;
+    Shader cullShader;
+    Uniform<GLint> uCullPatchCount;
+    Uniform<GLfloat> uCullCellSize, uCullMargin;
 
     GLuint vao, vbo, ebo;
+    GLuint gridVAO, gridVBO; // Share ebo with vao
     GLuint normalMapID;
+    GLuint displacementMapID; // Periodic, for renderers which tile the patch
+
+    VertexSource vertexSource;
+    int gridNodes; // Per side of the grid drawn with VertexSource::TEXTURE
+    GridIndices::Layout indexLayout;
+    bool shortIndices;
+    GLenum indexMode, indexType; // Of the EBO built by initGrid
 
     glm::vec3 windDir;
     float windSpeed;
     float amplitude;
 
-    glm::vec3 skyColor;
+    // std140 layout of the Water block, uploaded only by the setters
+    struct Material {
+        glm::vec3 ambient;
+        float exponent;
+        glm::vec3 diffuse;
+        float gNodes;
+        glm::vec3 specular;
+        float pad0;
+        glm::vec3 baseDim;
+        float pad1;
+        glm::vec3 baseBright;
+        float pad2;
+        glm::vec3 skyColor;
+        float pad3;
+        glm::vec3 sunDir;
+        float pad4;
+    };
+    static_assert(sizeof(Material) == 112, "Material must match the std140 Water block");
+
+    UniformBuffer<Material> material;
     glm::vec3 globalAmb;
-    glm::vec3 ambient, diffuse, specular;
-    float specExpoenent;
-    glm::vec3 baseDim, baseBright;
 
     EnvSky envSky;
 
+    Backend backend;
+    CpuOcean *cpuOcean;
+
     typedef std::normal_distribution<float> rand_distrib; // uniform_real_distribution<float>
     mutable std::mt19937 gen; // Standard mersenne twister engine
     mutable rand_distrib dis;
 
-    Shader showShader;
-    Shader normShader;
+    Shader showShader, gridShader;
+
+    // Handles of the water.frag uniforms, grid.vert ones are only valid for gridShader
+    struct ShowUniforms {
+        Uniform<bool> isMesh;
+        Uniform<glm::vec3> meshColor;
+        Uniform<GLint> normalMap, displacementMap, nodes, gridNodes;
+        Uniform<GLfloat> meshSize;
+    };
+    ShowUniforms showUniforms, gridUniforms;
+
+    // Compute programs with the grid size, workgroup shape and precision compiled in,
+    // and the handles of their uniforms resolved when the variant is built
+    struct Programs {
+        Shader ht, fourier;
+        Shader butt[2], fft[2]; // One per direction, fft is empty above FFT_MAX_N
+
+        Uniform<GLfloat> htL, htTime;
+        Uniform<bool> htPackReal, htSpectralNormals;
+        Uniform<GLint> fourierPP;
+        Uniform<GLfloat> fourierMeshSize;
+        Uniform<bool> fourierPackReal, fourierSpectralNormals, fourierWriteVertices;
+        Uniform<GLint> buttStage[2], buttPP[2], buttChannels[2], fftChannels[2];
+    };
+    typedef std::tuple<int, int, Precision> VariantKey; // N, WG_SIZE, precision
+    static std::map<VariantKey, Programs> variants; // Shared by all chunks of the context
 
     int fourierStages;
-    Shader htShader, buttShader, fourShader, perlinShader;
-    GLuint h0Tex, buttTex, perlinTex;
-    GLuint htHTex, htxTex, htzTex, ppTex;
+    int fftChannels;
+    int wgSize;
+    FFTMode fftMode;
+    bool realTransform;
+    bool spectralNormals;
+    Precision precision;
+    Programs programs;
+    Shader perlinShader;
+    GLuint h0Tex = 0, buttTex = 0, perlinTex = 0;
+    GLuint htTex = 0, ppTex = 0; // Texture arrays, one layer per channel
 
     // Debug
-    GLuint debugVAO, debugVBO;
+    GLuint debugVAO = 0, debugVBO = 0;
+    GLuint htHView = 0;
     Shader txShader;
 
-    std::vector<std::pair<int, int> > getElements() const;
+    static ShowUniforms getShowUniforms(const Shader &shader, bool fromTexture);
+    void initGrid();
+    void initCulling();
+    void initDisplacementMap();
+    void cull() const;
     void initDebug();
     void initTextures();
-    void ifft(GLuint src, int bPos) const;
+    void initCompute();
+    void initPrograms();
+    void updateChannels();
+    GLenum getSimFormat() const;
+    GLenum getMapFormat() const;
+    void ifft() const;
+    int ifftButterfly() const;
+    int ifftShared() const;
 
     GLuint loadTextureFromFile(const std::string &path, GLenum wrap, GLenum filter) const;
     GLuint generateEmptyTexture(int width, int height, GLenum type) const;
-    GLuint generateButterflyTexture(int N) const;
-    GLuint generateH0Texture() const;
+    GLuint generateEmptyTextureArray(int width, int height, int layers, GLenum format) const;
+    GLfloat* generateButterfly(int N) const;
+    GLuint generateButterflyTexture(const GLfloat *butterfly, int N) const;
+    GLfloat* generateH0() const;
+    GLuint generateH0Texture(const GLfloat *h0) const;
 
 public:
-    WaterMeshChunk(int dens, float size, int xs, int ys);
+    WaterMeshChunk(int dens, float size, int xs, int ys, Backend backend = Backend::GPU);
+    // Frees the buffers and textures of the chunk, its context must still be current
+    ~WaterMeshChunk();
+
+    WaterMeshChunk(const WaterMeshChunk&) = delete;
+    WaterMeshChunk& operator=(const WaterMeshChunk&) = delete;
+
+    // Fixed spectrum noise for chunks created after the call, random by default
+    static void setSeed(uint seed);
 
     void computePhysics(float absTime) const;
-    void show(const glm::mat4 &m_proj_view, bool isMesh, const Camera &cam) const;
-    void showDebugImage(const glm::mat4 &m_ortho, float time) const;
+    void show(const FrameUniforms &frame, bool isMesh) const;
+    void showDebugImage(const FrameUniforms &frame, float time) const;
 
 
     void setWind(const glm::vec3 &dir, float speed);
     void setAmplitude(float amp);
+    void setFFTMode(FFTMode mode);
+    void setRealTransform(bool packed);
+    void setSpectralNormals(bool spectral);
+    // Frustum culling of CULL_PATCH_CELLS patches before the draw, off by default:
+    // the saved vertex work does not pay for the pass while the simulation dominates the frame
+    void setCulling(bool enabled);
+    // Largest displacement from a grid node, patch bounds are inflated by it
+    void setCullMargin(float margin);
+    void setPrecision(Precision precision);
+    void setVertexSource(VertexSource source);
+    // Side of the grid drawn with VertexSource::TEXTURE, the simulation grid by default
+    void setGridNodes(int n);
+    // Strips of 16-bit indices by default, 32-bit from 2048 nodes where the grid row stride does not fit them
+    void setIndexLayout(GridIndices::Layout layout, bool shortIndices);
+    void setWorkGroupSize(int size);
+    void setThreadCount(int threads);
 
     void setSky(const EnvSky &sky);
     void setGlobalAmbient(const glm::vec3 &color);
@@ -85,12 +237,32 @@ public:
     void setSpecular(const glm::vec3 &color, float exp);
 
     void update();
+    // Binds the Water block to MATERIAL_UBO_BINDING for renderers sharing the material
+    void bindMaterial() const;
 
 
     int getWidth() const;
     int getHeight() const;
     float getSize() const;
     glm::vec3 getOffset() const;
+    Backend getBackend() const;
+    FFTMode getFFTMode() const;
+    bool isRealTransform() const;
+    bool isSpectralNormals() const;
+    bool isCulling() const;
+    int getPatchCount() const;
+    // Visible patches CULL_STATS_FRAMES frames ago, all of them without culling
+    int getVisiblePatches() const;
+    Precision getPrecision() const;
+    VertexSource getVertexSource() const;
+    int getGridNodes() const;
+    GridIndices::Layout getIndexLayout() const;
+    // Whether the EBO actually has 16-bit indices
+    bool isShortIndices() const;
+    int getWorkGroupSize() const;
+    int getThreadCount() const;
+    GLuint getNormalMap() const;
+    GLuint getDisplacementMap() const;
 };
 
 #endif
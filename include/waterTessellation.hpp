@@ -0,0 +1,39 @@
+#ifndef __WATER_TESSELLATION_H__
+#define __WATER_TESSELLATION_H__
+
+#include "util/glew.hpp"
+#include "GLFW/glfw3.h"
+
+#include "util/shader.hpp"
+#include "frameData.hpp"
+#include "waterMeshChunk.hpp"
+
+// Coarse grid of quad patches around the camera, subdivided by the tessellator so that
+// triangle edges are about edgePixels long on the screen. The evaluation shader displaces
+// vertices from the periodic maps of one WaterMeshChunk, so the vertex count follows
+// the view, not the simulation grid. Like Shader, copies share the same GL objects.
+class WaterTessellation {
+private:
+    int patches;     // Per side
+    float patchSize;
+    float edgePixels = 12.f;
+    GLint maxLevel;
+
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    GLuint sampler = 0; // Repeat and mipmaps over the textures of the chunk
+    GLsizei indexCount = 0;
+    Shader shader;
+
+public:
+    WaterTessellation() = default;
+    WaterTessellation(int patches, float patchSize);
+
+    void show(const FrameUniforms &frame, const WaterMeshChunk &water, bool isMesh) const;
+
+    void setEdgePixels(float pixels);
+
+    // Distance from the camera to the edge of the grid
+    float getRange() const;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __WATER_TILES_H__
+#define __WATER_TILES_H__
+
+#include "util/glew.hpp"
+#include "GLFW/glfw3.h"
+
+#include "util/shader.hpp"
+#include "frameData.hpp"
+#include "waterMeshChunk.hpp"
+
+#include <vector>
+
+// Square of (2 * radius + 1)^2 copies of one periodic WaterMeshChunk around the camera, drawn
+// as instances of one grid with the resolution of the simulation. The vertex shader displaces
+// the grid from the maps of the chunk, tiles start at its offset. Tiles outside the view frustum
+// are culled on the CPU by their bounds inflated by the displacement margin.
+// Like Shader, copies share the same GL objects.
+class WaterTiles {
+private:
+    int nodes;    // Grid cells per tile side
+    int radius;   // Tiles from the camera tile to the edge
+    float margin; // Largest displacement from the grid node
+    bool culling = true;
+
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    GLuint instanceVBO = 0; // Tile coordinates of the visible tiles, refilled every frame
+    GLuint sampler = 0;     // Repeat over the textures of the chunk
+    GLsizei indexCount = 0;
+    Shader shader;
+
+    mutable std::vector<GLint> visible;
+
+public:
+    WaterTiles() = default;
+    WaterTiles(const WaterMeshChunk &water, int radius, float margin);
+
+    void show(const FrameUniforms &frame, const WaterMeshChunk &water, bool isMesh) const;
+
+    void setRadius(int radius);
+    void setCulling(bool enabled);
+
+    // Distance from the camera to the farthest edge of the tiled square along an axis
+    float getRange(const WaterMeshChunk &water) const;
+    int getTileCount() const;
+    // Tiles drawn by the last show
+    int getVisibleTiles() const;
+    int getVertexCount() const; // Per tile
+};
+
+#endif
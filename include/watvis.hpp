@@ -0,0 +1,34 @@
+#ifndef __WATVIS_H__
+#define __WATVIS_H__
+
+// Public API of the watvis library. Needs a current GL 4.3 context with GLEW initialized,
+// shaders and fonts are loaded from ./shaders and ./resources.
+
+#include "util/glew.hpp"
+
+// Ocean
+#include "waterMeshChunk.hpp"
+#include "waterClipmap.hpp"
+#include "waterTessellation.hpp"
+#include "waterTiles.hpp"
+#include "cpuOcean.hpp"
+#include "gridIndices.hpp"
+#include "envSky.hpp"
+#include "frameData.hpp"
+#include "debugInformer.hpp"
+
+// Rendering
+#include "util/shader.hpp"
+#include "util/uniformBuffer.hpp"
+#include "util/renderTarget.hpp"
+#include "util/font.hpp"
+#include "util/image.hpp"
+#include "util/camera.hpp"
+#include "util/cameraPath.hpp"
+
+// Profiling
+#include "util/gpuProfiler.hpp"
+#include "util/tracer.hpp"
+#include "util/benchmarkReport.hpp"
+
+#endif
@@ -0,0 +1,57 @@
+#version 430 core
+
+layout (std140, binding = 0) uniform Frame {
+    mat4 projView;
+    mat4 skyProjView;
+    mat4 ortho;
+    vec4 eye;
+    float time;
+    vec4 viewport;
+} frame;
+
+layout (std140, binding = 1) uniform Water {
+    vec3 ambient;
+    float exponent;
+    vec3 diffuse;
+    float gNodes;
+    vec3 specular;
+    vec3 baseDim;
+    vec3 baseBright;
+    vec3 skyColor;
+    vec3 sunDir;
+} water;
+
+// Share of the level half-size after which odd vertices start moving onto the coarser grid
+#define MORPH_START 0.7
+
+layout (location = 0) in ivec2 vertex; // Node of the level grid, 0..gridSize
+
+uniform ivec2 origin; // In cells of the finest level
+uniform int scale;    // Cells of the finest level per cell of this one
+uniform int gridSize;
+uniform float cellSize;
+
+uniform sampler2D displacementMap; // Periodic, one patch is gNodes wide
+
+out vec3 vpos;
+out vec2 texc;
+
+void main() {
+    // Fully morphed on the outer edge, where the coarser level starts
+    vec2 local = vec2(vertex) / float(gridSize) * 2.0 - 1.0;
+    float morph = clamp((max(abs(local.x), abs(local.y)) - MORPH_START) / (1.0 - MORPH_START), 0.0, 1.0);
+
+    vec2 node = vec2(origin + vertex * scale) - vec2(vertex & 1) * float(scale) * morph;
+    vec2 xz = node * cellSize;
+    // Simulation nodes are at texel centres
+    float nodes = float(textureSize(displacementMap, 0).x);
+    texc = xz / water.gNodes + 0.5 / nodes;
+
+    // Mip level follows the cell and steps by one over the morph zone, like the next level
+    float texel = water.gNodes / nodes;
+    float lod = max(log2(float(scale) * cellSize / texel) + morph, 0.0);
+    vec3 d = textureLod(displacementMap, texc, lod).xyz;
+
+    vpos = vec3(xz.x + d.x, d.y, xz.y + d.z);
+    gl_Position = frame.projView * vec4(vpos, 1.0);
+}
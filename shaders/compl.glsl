@@ -0,0 +1,14 @@
+// Complex arithmetic shared by the FFT shaders, included after #version
+
+struct compl {
+    float Re, Im;
+};
+compl vcompl(vec2 v) {
+    return compl(v.x, v.y);
+}
+compl mul(compl lhs, compl rhs) {
+    return compl(lhs.Re * rhs.Re - lhs.Im * rhs.Im, lhs.Re * rhs.Im + lhs.Im * rhs.Re);
+}
+compl add(compl lhs, compl rhs) {
+    return compl(lhs.Re + rhs.Re, lhs.Im + rhs.Im);
+}
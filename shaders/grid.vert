@@ -0,0 +1,44 @@
+#version 430 core
+
+layout (std140, binding = 0) uniform Frame {
+    mat4 projView;
+    mat4 skyProjView;
+    mat4 ortho;
+    vec4 eye;
+    float time;
+    vec4 viewport;
+} frame;
+
+layout (std140, binding = 1) uniform Water {
+    vec3 ambient;
+    float exponent;
+    vec3 diffuse;
+    float gNodes;
+    vec3 specular;
+    vec3 baseDim;
+    vec3 baseBright;
+    vec3 skyColor;
+    vec3 sunDir;
+} water;
+
+layout (location = 0) in ivec2 vertex; // Node of the flat grid, 0..gridNodes-1
+
+uniform int nodes;     // Of the simulation
+uniform int gridNodes;
+uniform float meshSize;
+
+uniform sampler2D displacementMap;
+
+out vec3 vpos;
+out vec2 texc;
+
+void main() {
+    // In simulation nodes, texel centres are hit exactly when both grids match. The displacement then equals
+    // the one written to the VBO, up to the rounding of an RGBA16F map with half precision
+    vec2 node = vec2(vertex) * (float(nodes) / float(gridNodes));
+    texc = (node + 0.5) / float(nodes);
+    vec3 d = textureLod(displacementMap, texc, 0.0).xyz;
+
+    vpos = vec3(node.x * meshSize + d.x, d.y, node.y * meshSize + d.z);
+    gl_Position = frame.projView * vec4(vpos, 1.0);
+}
@@ -1,8 +1,11 @@
 #version 430 core
 
-uniform vec3 sunColor;
+layout (std140, binding = 1) uniform Sun {
+    vec3 color;
+} sun;
+
 out vec4 color;
 
 void main() {
-    color = vec4(sunColor, 1.0);
+    color = vec4(sun.color, 1.0);
 }
\ No newline at end of file
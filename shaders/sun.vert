@@ -1,8 +1,16 @@
 #version 430 core
 
-uniform mat4 projection;
+layout (std140, binding = 0) uniform Frame {
+    mat4 projView;
+    mat4 skyProjView;
+    mat4 ortho;
+    vec4 eye;
+    float time;
+    vec4 viewport;
+} frame;
+
 layout (location = 0) in vec3 vertex;
 
 void main() {
-    gl_Position = projection * vec4(vertex, 1.0);
+    gl_Position = frame.skyProjView * vec4(vertex, 1.0);
 }
@@ -0,0 +1,12 @@
+#version 430 core
+
+layout (location = 0) in ivec2 vertex; // Corner of a patch, 0..patches
+
+uniform ivec2 origin; // In patches
+uniform float patchSize;
+
+out vec2 cornerXZ;
+
+void main() {
+    cornerXZ = vec2(origin + vertex) * patchSize;
+}
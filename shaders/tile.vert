@@ -0,0 +1,44 @@
+#version 430 core
+
+layout (std140, binding = 0) uniform Frame {
+    mat4 projView;
+    mat4 skyProjView;
+    mat4 ortho;
+    vec4 eye;
+    float time;
+    vec4 viewport;
+} frame;
+
+layout (std140, binding = 1) uniform Water {
+    vec3 ambient;
+    float exponent;
+    vec3 diffuse;
+    float gNodes;
+    vec3 specular;
+    vec3 baseDim;
+    vec3 baseBright;
+    vec3 skyColor;
+    vec3 sunDir;
+} water;
+
+layout (location = 0) in ivec2 vertex; // Node of the tile grid, 0..nodes
+layout (location = 1) in ivec2 tile;   // Per instance
+
+uniform int nodes;
+uniform vec2 origin; // Corner of tile (0, 0)
+
+uniform sampler2D displacementMap; // Periodic, one tile is gNodes wide
+
+out vec3 vpos;
+out vec2 texc;
+
+void main() {
+    // Neighbour tiles share the edge nodes, both read the same texel through the repeat
+    ivec2 node = tile * nodes + vertex;
+    vec2 xz = origin + vec2(node) * (water.gNodes / float(nodes));
+    texc = (vec2(vertex) + 0.5) / float(nodes);
+    vec3 d = textureLod(displacementMap, texc, 0.0).xyz;
+
+    vpos = vec3(xz.x + d.x, d.y, xz.y + d.z);
+    gl_Position = frame.projView * vec4(vpos, 1.0);
+}
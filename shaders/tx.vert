@@ -1,10 +1,17 @@
 #version 430 core
 
-uniform mat4 projection;
+layout (std140, binding = 0) uniform Frame {
+    mat4 projView;
+    mat4 skyProjView;
+    mat4 ortho;
+    vec4 eye;
+    float time;
+    vec4 viewport;
+} frame;
 layout (location = 0) in vec4 vertex;
 out vec2 TexCoords;
 
 void main() {
-    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+    gl_Position = frame.ortho * vec4(vertex.xy, 0.0, 1.0);
     TexCoords = vertex.zw;
 }
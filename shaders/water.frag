@@ -4,32 +4,31 @@
 #define M_1_PI 0.318309886183790671538
 #define M_SQRT1_2 0.707106781186547524401
 
-struct Material {
+layout (std140, binding = 0) uniform Frame {
+    mat4 projView;
+    mat4 skyProjView;
+    mat4 ortho;
+    vec4 eye;
+    float time;
+    vec4 viewport;
+} frame;
+
+layout (std140, binding = 1) uniform Water {
     vec3 ambient;
+    float exponent;
     vec3 diffuse;
+    float gNodes;
     vec3 specular;
-    float exponent;
-};
+    vec3 baseDim;
+    vec3 baseBright;
+    vec3 skyColor;
+    vec3 sunDir;
+} water;
 
 uniform bool is_mesh;
 uniform vec3 mesh_color;
 
-uniform vec3 eye_pos;
-uniform vec3 globalAmb;
-
-uniform vec3 skyColor;
-
-uniform vec3 sunDir;
-uniform float sunAngle;
-uniform vec3 sunColor;
-
-uniform vec3 baseDim;
-uniform vec3 baseBright;
-
-uniform Material mat;
-
 uniform sampler2D normalMap;
-uniform sampler2D perlinNoise;
 
 in vec3 vpos;
 in vec2 texc;
@@ -43,8 +42,8 @@ void main() {
     else {
         const float brightTreshold = 0.99;
         vec3 normal = normalize(texture(normalMap, texc).xyz);
-        vec3 viewDir = normalize(eye_pos - vpos);
-        vec3 halfway = normalize(sunDir + viewDir);
+        vec3 viewDir = normalize(frame.eye.xyz - vpos);
+        vec3 halfway = normalize(water.sunDir + viewDir);
         vec3 reflDir = normalize(reflect(viewDir, normal));
 
         float cost1 = dot(viewDir, normal);
@@ -54,24 +53,24 @@ void main() {
         fresnel = fresnel * fresnel;
 
         float ambient = max(0.0, dot(reflDir, viewDir));
-        float diffuse = -min(0.0, dot(normal, sunDir));
-        float specular = pow(max(0.0, dot(normal, halfway)), mat.exponent);
+        float diffuse = -min(0.0, dot(normal, water.sunDir));
+        float specular = pow(max(0.0, dot(normal, halfway)), water.exponent);
 
         vec3 res;
         if (specular >= brightTreshold)
-            res = baseBright;
+            res = water.baseBright;
         else
-            res = baseDim +
-                ambient * mat.ambient +
-                diffuse * fresnel * mat.diffuse +
-                specular * fresnel * mat.specular;
+            res = water.baseDim +
+                ambient * water.ambient +
+                diffuse * fresnel * water.diffuse +
+                specular * fresnel * water.specular;
 
-        // float sunOff = acos(dot(reflDir, -sunDir));
+        // float sunOff = acos(dot(reflDir, -water.sunDir));
         // if (sunOff <= sunAngle)
         //     res += sunColor;
         // else
         //     res += skyColor;
-        res += skyColor;
+        res += water.skyColor;
 
         if(res.b < 0.9)
             res *= fresnel;
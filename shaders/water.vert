@@ -1,8 +1,25 @@
 #version 430 core
 
-uniform mat4 m_proj_view;
+layout (std140, binding = 0) uniform Frame {
+    mat4 projView;
+    mat4 skyProjView;
+    mat4 ortho;
+    vec4 eye;
+    float time;
+    vec4 viewport;
+} frame;
 
-uniform float gNodes;
+layout (std140, binding = 1) uniform Water {
+    vec3 ambient;
+    float exponent;
+    vec3 diffuse;
+    float gNodes;
+    vec3 specular;
+    vec3 baseDim;
+    vec3 baseBright;
+    vec3 skyColor;
+    vec3 sunDir;
+} water;
 
 layout (location = 0) in vec3 pos;
 
@@ -10,7 +27,7 @@ out vec3 vpos;
 out vec2 texc;
 
 void main() {
-    gl_Position = m_proj_view * vec4(pos, 1.0);
+    gl_Position = frame.projView * vec4(pos, 1.0);
     vpos = pos;
-    texc = vec2(pos.x / gNodes, pos.z / gNodes);
+    texc = vec2(pos.x / water.gNodes, pos.z / water.gNodes);
 }
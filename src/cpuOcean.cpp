@@ -0,0 +1,417 @@
+#include "../include/cpuOcean.hpp"
+#include "../include/util/utility.hpp"
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define CPU_SIMD_WIDTH 8
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define CPU_SIMD_WIDTH 4
+#include <emmintrin.h>
+#else
+#define CPU_SIMD_WIDTH 1
+#endif
+
+// SIMD wrappers, the widest instruction set enabled at compile time is used.
+// Arithmetic operators on __m128/__m256 are GCC/Clang vector extensions.
+
+#if CPU_SIMD_WIDTH == 8
+
+typedef __m256 vfloat;
+
+static inline vfloat vset(float v) { return _mm256_set1_ps(v); }
+static inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float *p, vfloat v) { _mm256_storeu_ps(p, v); }
+static inline vfloat vfma(vfloat a, vfloat b, vfloat c) { return _mm256_fmadd_ps(a, b, c); }
+static inline vfloat vsqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+static inline vfloat vfloor(vfloat a) { return _mm256_floor_ps(a); }
+static inline vfloat veq(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+static inline vfloat vge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline vfloat vselect(vfloat m, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, m); }
+static inline vfloat vor(vfloat a, vfloat b) { return _mm256_or_ps(a, b); }
+
+#elif CPU_SIMD_WIDTH == 4
+
+typedef __m128 vfloat;
+
+static inline vfloat vset(float v) { return _mm_set1_ps(v); }
+static inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+static inline void vstore(float *p, vfloat v) { _mm_storeu_ps(p, v); }
+static inline vfloat vfma(vfloat a, vfloat b, vfloat c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static inline vfloat vsqrt(vfloat a) { return _mm_sqrt_ps(a); }
+static inline vfloat vfloor(vfloat a) {
+    vfloat t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.f)));
+}
+static inline vfloat veq(vfloat a, vfloat b) { return _mm_cmpeq_ps(a, b); }
+static inline vfloat vge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+static inline vfloat vselect(vfloat m, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+static inline vfloat vor(vfloat a, vfloat b) { return _mm_or_ps(a, b); }
+
+#else
+
+typedef float vfloat;
+
+static inline vfloat vset(float v) { return v; }
+static inline vfloat vload(const float *p) { return *p; }
+static inline void vstore(float *p, vfloat v) { *p = v; }
+static inline vfloat vfma(vfloat a, vfloat b, vfloat c) { return a * b + c; }
+static inline vfloat vsqrt(vfloat a) { return sqrtf(a); }
+static inline vfloat vfloor(vfloat a) { return floorf(a); }
+static inline vfloat veq(vfloat a, vfloat b) { return a == b ? 1.f : 0.f; }
+static inline vfloat vge(vfloat a, vfloat b) { return a >= b ? 1.f : 0.f; }
+static inline vfloat vselect(vfloat m, vfloat a, vfloat b) { return m != 0.f ? a : b; }
+static inline vfloat vor(vfloat a, vfloat b) { return (a != 0.f || b != 0.f) ? 1.f : 0.f; }
+
+#endif
+
+static constexpr int VW = CPU_SIMD_WIDTH;
+
+// Floats per array touched by one task: an FFT strip of re and im fits into L2,
+// a block of rows into L1
+static constexpr int STRIP_TILE_FLOATS = 65536;
+static constexpr int ROW_TILE_FLOATS = 2048;
+static constexpr int TRANSPOSE_BLOCK = 16;
+// FFT rows are padded, a power of two apart they would fall into the same cache sets
+static constexpr int ROW_PADDING = 16;
+
+// Scalar and vector code paths of the same kernel
+template<class V> static inline V splat(float v);
+template<class V> static inline V load(const float *p);
+template<> inline float splat<float>(float v) { return v; }
+template<> inline float load<float>(const float *p) { return *p; }
+#if CPU_SIMD_WIDTH > 1
+template<> inline vfloat splat<vfloat>(float v) { return vset(v); }
+template<> inline vfloat load<vfloat>(const float *p) { return vload(p); }
+static inline float vsqrt(float a) { return sqrtf(a); }
+#endif
+
+// Cephes-style sincos: reduction to [-pi/4; pi/4] and minimax polynomials
+static inline void vsincos(vfloat x, vfloat &s, vfloat &c) {
+    vfloat q = vfloor(vfma(x, vset(2.f * (float)M_1_PI), vset(0.5f)));
+    vfloat y = x - q * vset(1.5703125f);
+    y = y - q * vset(4.837512969970703125e-4f);
+    y = y - q * vset(7.54978995489188216e-8f);
+    vfloat z = y * y;
+
+    vfloat ps = vfma(vfma(vset(-1.9515295891e-4f), z, vset(8.3321608736e-3f)), z, vset(-1.6666654611e-1f));
+    ps = vfma(ps * z, y, y);
+    vfloat pc = vfma(vfma(vset(2.443315711809948e-5f), z, vset(-1.388731625493765e-3f)), z, vset(4.166664568298827e-2f));
+    pc = vfma(pc * z, z, vset(1.f) - vset(0.5f) * z);
+
+    // Quadrant: 1 and 3 swap sin and cos, signs follow the unit circle
+    vfloat quad = q - vset(4.f) * vfloor(q * vset(0.25f));
+    vfloat swap = vor(veq(quad, vset(1.f)), veq(quad, vset(3.f)));
+    vfloat sRes = vselect(swap, pc, ps);
+    vfloat cRes = vselect(swap, ps, pc);
+    s = vselect(vge(quad, vset(2.f)), vset(0.f) - sRes, sRes);
+    c = vselect(vor(veq(quad, vset(1.f)), veq(quad, vset(2.f))), vset(0.f) - cRes, cRes);
+}
+
+CpuOcean::CpuOcean(int nodes, float size, int threads) : pool(threads) {
+    assert(nodes >= VW && (nodes & (nodes - 1)) == 0);
+
+    this->nodes = nodes;
+    this->logN = log2i(nodes);
+    this->size = size;
+    this->stripWidth = std::min(nodes, std::max(VW, STRIP_TILE_FLOATS / nodes));
+    this->rowGrain = std::max(1, ROW_TILE_FLOATS / nodes);
+    this->stride = nodes + ROW_PADDING;
+
+    size_t count = (size_t)nodes * nodes;
+    for (auto *v : { &h0Re, &h0Im, &h0cRe, &h0cIm, &kxn, &kzn, &omega, &px, &py, &pz })
+        v->assign(count, 0.f);
+    for (int ch = 0; ch < 2; ch++) {
+        re[ch].assign(nodes * stride, 0.f);
+        im[ch].assign(nodes * stride, 0.f);
+        tre[ch].assign(nodes * stride, 0.f);
+        tim[ch].assign(nodes * stride, 0.f);
+    }
+    vertices.assign(count * 3, 0.f);
+    normals.assign(count * 4, 0.f);
+    displacement.assign(count * 3, 0.f);
+
+    // Same wave vectors as ht.comp
+    float L = nodes * size;
+    for (int z = 0; z < nodes; z++) {
+        for (int x = 0; x < nodes; x++) {
+            size_t i = (size_t)z * nodes + x;
+            float kx = 2.f * (float)M_PI * (x - nodes / 2.f) / L;
+            float kz = 2.f * (float)M_PI * (z - nodes / 2.f) / L;
+            float mg = std::max(1e-5f, sqrtf(kx * kx + kz * kz));
+            kxn[i] = x == 0 ? 0.f : kx / mg;
+            kzn[i] = z == 0 ? 0.f : kz / mg;
+            omega[i] = sqrtf(9.81f * mg);
+        }
+    }
+
+    twRe.resize(nodes / 2);
+    twIm.resize(nodes / 2);
+    for (int m = 0; m < nodes / 2; m++) {
+        twRe[m] = cos(2.0 * M_PI * m / nodes);
+        twIm[m] = sin(2.0 * M_PI * m / nodes);
+    }
+    rev.resize(nodes);
+    for (int i = 0; i < nodes; i++)
+        rev[i] = reverseBits(i, logN);
+}
+
+void CpuOcean::setSpectrum(const float *h0) {
+    size_t count = (size_t)nodes * nodes;
+    for (size_t i = 0; i < count; i++) {
+        h0Re[i] = h0[i * 4 + 0];
+        h0Im[i] = h0[i * 4 + 1];
+        h0cRe[i] = h0[i * 4 + 2];
+        h0cIm[i] = h0[i * 4 + 3];
+    }
+}
+
+void CpuOcean::setThreadCount(int threads) {
+    pool.setThreadCount(threads);
+}
+
+int CpuOcean::getThreadCount() const {
+    return pool.getThreadCount();
+}
+
+void CpuOcean::compute(float time) {
+    pool.parallelFor(nodes, rowGrain, [&](int z0, int z1) {
+        evalSpectrum(time, z0, z1);
+    });
+
+    // Columns, then rows through the transposed copy
+    fftPass(re, im);
+    int block = std::min(TRANSPOSE_BLOCK, nodes), blocks = nodes / block;
+    pool.parallelFor(4 * blocks, 1, [&](int b0, int b1) {
+        std::vector<float> *src[4] = { &re[0], &im[0], &re[1], &im[1] };
+        std::vector<float> *dst[4] = { &tre[0], &tim[0], &tre[1], &tim[1] };
+        for (int b = b0; b < b1; b++) {
+            int arr = b / blocks, z0 = (b % blocks) * block;
+            transpose(src[arr]->data(), dst[arr]->data(), z0, z0 + block);
+        }
+    });
+    fftPass(tre, tim);
+
+    pool.parallelFor(blocks, 1, [&](int b0, int b1) {
+        computePositions(b0 * block, b1 * block);
+    });
+    pool.parallelFor(nodes, rowGrain, [&](int z0, int z1) {
+        computeNormals(z0, z1);
+    });
+}
+
+// Both channels at once, each task transforms one strip of columns
+void CpuOcean::fftPass(std::vector<float> *sre, std::vector<float> *sim) {
+    int strips = nodes / stripWidth;
+    pool.parallelFor(2 * strips, 1, [&](int s0, int s1) {
+        for (int s = s0; s < s1; s++) {
+            int ch = s / strips, x0 = (s % strips) * stripWidth;
+            fftStrip(sre[ch].data() + x0, sim[ch].data() + x0, stripWidth);
+        }
+    });
+}
+
+// h(k, t) and packed dx + i * dz for rows [z0; z1), see ht.comp
+void CpuOcean::evalSpectrum(float time, int z0, int z1) {
+    vfloat vt = vset(time);
+    for (size_t z = z0; z < (size_t)z1; z++) {
+        for (size_t x = 0; x < (size_t)nodes; x += VW) {
+            size_t i = z * nodes + x, p = z * stride + x;
+            vfloat s, c;
+            vsincos(vload(&omega[i]) * vt, s, c);
+
+            vfloat aRe = vload(&h0Re[i]), aIm = vload(&h0Im[i]);
+            vfloat bRe = vload(&h0cRe[i]), bIm = vload(&h0cIm[i]);
+            vfloat hRe = (aRe + bRe) * c - (aIm - bIm) * s;
+            vfloat hIm = (aIm + bIm) * c + (aRe - bRe) * s;
+
+            // dx = -i * kx / |k| * h, dz = -i * kz / |k| * h
+            vfloat kx = vload(&kxn[i]), kz = vload(&kzn[i]);
+            vstore(&re[0][p], kx * hIm + kz * hRe);
+            vstore(&im[0][p], kz * hIm - kx * hRe);
+            vstore(&re[1][p], hRe);
+            vstore(&im[1][p], hIm);
+        }
+    }
+}
+
+// Inverse FFT along z of a strip of width columns, vectorized across x
+void CpuOcean::fftStrip(float *sre, float *sim, int width) const {
+    for (int i = 0; i < nodes; i++) {
+        int j = rev[i];
+        if (j > i) {
+            std::swap_ranges(sre + i * stride, sre + i * stride + width, sre + j * stride);
+            std::swap_ranges(sim + i * stride, sim + i * stride + width, sim + j * stride);
+        }
+    }
+
+    for (int stage = 0; stage < logN; stage++) {
+        int span = 1 << stage;
+        for (int b = 0; b < nodes / 2; b++) {
+            int j = b & (span - 1);
+            int i0 = ((b >> stage) << (stage + 1)) + j;
+            int i1 = i0 + span;
+            vfloat wRe = vset(twRe[j << (logN - stage - 1)]);
+            vfloat wIm = vset(twIm[j << (logN - stage - 1)]);
+
+            float *r0 = sre + i0 * stride, *r1 = sre + i1 * stride;
+            float *m0 = sim + i0 * stride, *m1 = sim + i1 * stride;
+            for (int x = 0; x < width; x += VW) {
+                vfloat qRe = vload(r1 + x), qIm = vload(m1 + x);
+                vfloat tRe = wRe * qRe - wIm * qIm;
+                vfloat tIm = vfma(wRe, qIm, wIm * qRe);
+                vfloat pRe = vload(r0 + x), pIm = vload(m0 + x);
+                vstore(r0 + x, pRe + tRe);
+                vstore(m0 + x, pIm + tIm);
+                vstore(r1 + x, pRe - tRe);
+                vstore(m1 + x, pIm - tIm);
+            }
+        }
+    }
+}
+
+// Rows [z0; z1) of src into columns of dst, z0 and z1 are multiples of the block
+void CpuOcean::transpose(const float *src, float *dst, int z0, int z1) const {
+    int block = std::min(TRANSPOSE_BLOCK, nodes);
+    for (int zb = z0; zb < z1; zb += block)
+        for (int x0 = 0; x0 < nodes; x0 += block)
+            for (int z = zb; z < zb + block; z++)
+                for (int x = x0; x < x0 + block; x++)
+                    dst[(size_t)x * stride + z] = src[(size_t)z * stride + x];
+}
+
+// Transposed result holds (x, z) at [x * stride + z], see fourier.comp for the rest.
+// Rows [z0; z1) are a multiple of the transpose block and are done in square tiles.
+void CpuOcean::computePositions(int z0, int z1) {
+    float norm = 1.f / ((float)nodes * nodes);
+    int block = std::min(TRANSPOSE_BLOCK, nodes);
+    for (int zb = z0; zb < z1; zb += block) {
+        for (int xb = 0; xb < nodes; xb += block) {
+            for (int z = zb; z < zb + block; z++) {
+                for (int x = xb; x < xb + block; x++) {
+                    size_t t = (size_t)x * stride + z;
+                    size_t i = (size_t)z * nodes + x;
+                    float sign = ((x + z) & 1) ? -norm : norm;
+                    px[i] = x * size - sign * tre[0][t];
+                    py[i] = sign * tre[1][t];
+                    pz[i] = z * size - sign * tim[0][t];
+
+                    vertices[i * 3 + 0] = px[i];
+                    vertices[i * 3 + 1] = py[i];
+                    vertices[i * 3 + 2] = pz[i];
+
+                    displacement[i * 3 + 0] = -sign * tre[0][t];
+                    displacement[i * 3 + 1] = py[i];
+                    displacement[i * 3 + 2] = -sign * tim[0][t];
+                }
+            }
+        }
+    }
+}
+
+template<class V>
+static inline void normalizeVec(V &x, V &y, V &z) {
+    V len = vsqrt(x * x + y * y + z * z);
+    x = x / len;
+    y = y / len;
+    z = z / len;
+}
+
+// Same stencil as fourier.comp: four normalized edges and their cross products,
+// the Jacobian from central differences.
+// nb - center, negy, negx, posy, posx; shift - offsets of the neighbours across the border
+template<class V>
+static inline void normalKernel(const float *px, const float *py, const float *pz,
+        const size_t nb[5], const float shift[4], float size, V &nx, V &ny, V &nz, V &jac) {
+    V cx = load<V>(px + nb[0]), cy = load<V>(py + nb[0]), cz = load<V>(pz + nb[0]);
+    V bx[4], by[4], bz[4];
+    V ex[4], ey[4], ez[4];
+    for (int i = 0; i < 4; i++) {
+        bx[i] = load<V>(px + nb[i + 1]);
+        by[i] = load<V>(py + nb[i + 1]);
+        bz[i] = load<V>(pz + nb[i + 1]);
+        if (i & 1)
+            bx[i] = bx[i] + splat<V>(shift[i]);
+        else
+            bz[i] = bz[i] + splat<V>(shift[i]);
+
+        ex[i] = bx[i] - cx;
+        ey[i] = by[i] - cy;
+        ez[i] = bz[i] - cz;
+        normalizeVec(ex[i], ey[i], ez[i]);
+    }
+    nx = ny = nz = splat<V>(0.f);
+    for (int i = 0; i < 4; i++) {
+        int j = (i + 1) % 4;
+        nx = nx + (ey[i] * ez[j] - ez[i] * ey[j]);
+        ny = ny + (ez[i] * ex[j] - ex[i] * ez[j]);
+        nz = nz + (ex[i] * ey[j] - ey[i] * ex[j]);
+    }
+    normalizeVec(nx, ny, nz);
+
+    V inv = splat<V>(0.5f / size);
+    V dxx = (bx[3] - bx[1]) * inv, dxz = (bz[3] - bz[1]) * inv;
+    V dzx = (bx[2] - bx[0]) * inv, dzz = (bz[2] - bz[0]) * inv;
+    jac = dxx * dzz - dzx * dxz;
+}
+
+// The surface is periodic, neighbours across the border are shifted by its size
+void CpuOcean::computeNormals(int z0, int z1) {
+    auto storeNormal = [this](size_t i, float x, float y, float z, float jac) {
+        normals[i * 4 + 0] = x;
+        normals[i * 4 + 1] = y;
+        normals[i * 4 + 2] = z;
+        normals[i * 4 + 3] = jac;
+    };
+
+    float period = nodes * size;
+    for (int z = z0; z < z1; z++) {
+        size_t row = (size_t)z * nodes;
+        size_t rowP = (size_t)((z + 1) % nodes) * nodes;
+        size_t rowN = (size_t)((z + nodes - 1) % nodes) * nodes;
+        float shiftP = z == nodes - 1 ? period : 0.f;
+        float shiftN = z == 0 ? -period : 0.f;
+
+        // Interior, vectorized
+        int x = 1;
+        if (nodes > 2 * VW) {
+            float shift[4] = { shiftN, 0.f, shiftP, 0.f };
+            for (; x + VW <= nodes - 1; x += VW) {
+                size_t nb[5] = { row + x, rowN + x, row + x - 1, rowP + x, row + x + 1 };
+                vfloat nx, ny, nz, jac;
+                normalKernel<vfloat>(px.data(), py.data(), pz.data(), nb, shift, size, nx, ny, nz, jac);
+                float bx[VW], by[VW], bz[VW], bj[VW];
+                vstore(bx, nx);
+                vstore(by, ny);
+                vstore(bz, nz);
+                vstore(bj, jac);
+                for (int i = 0; i < VW; i++)
+                    storeNormal(row + x + i, bx[i], by[i], bz[i], bj[i]);
+            }
+        }
+
+        // Edges and the tail
+        for (int xx = 0; xx < nodes; xx = (xx == 0 ? x : xx + 1)) {
+            float shift[4] = { shiftN, xx == 0 ? -period : 0.f, shiftP, xx == nodes - 1 ? period : 0.f };
+            size_t nb[5] = { row + xx, rowN + xx, row + (xx + nodes - 1) % nodes,
+                rowP + xx, row + (xx + 1) % nodes };
+            float nx, ny, nz, jac;
+            normalKernel<float>(px.data(), py.data(), pz.data(), nb, shift, size, nx, ny, nz, jac);
+            storeNormal(row + xx, nx, ny, nz, jac);
+        }
+    }
+}
+
+const float* CpuOcean::getVertices() const {
+    return vertices.data();
+}
+
+const float* CpuOcean::getNormals() const {
+    return normals.data();
+}
+
+const float* CpuOcean::getDisplacement() const {
+    return displacement.data();
+}
@@ -1,4 +1,5 @@
 #include "../include/debugInformer.hpp"
+#include "../include/util/gpuProfiler.hpp"
 #include <sstream>
 
 DebugInformer::DebugInformer() {
@@ -10,9 +11,10 @@ DebugInformer::~DebugInformer() {
     delete font;
 }
 
-void DebugInformer::show(const glm::mat4 &m_ortho, float width, float height) const {
+void DebugInformer::show(const FrameUniforms &frame, float width, float height) const {
+    GPU_SCOPE("text");
     shader.use();
-    shader.setUniform("projection", m_ortho);
+    frame.bind(FRAME_UBO_BINDING);
 
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
@@ -33,6 +35,16 @@ void DebugInformer::show(const glm::mat4 &m_ortho, float width, float height) co
     builder = std::stringstream();
     builder << "fps: " << fps << " ftime: " << formatFloat("%.3f", 1000.f / fps) << "us ";
     font->RenderText(shader, builder.str(), width - 280, height - 20, 0.5, glm::vec3(0.f));
+
+    // GPU passes, last min/avg/max, under the custom text
+    float y = height - 60;
+    for (const auto &s : GpuProfiler::get().getStats()) {
+        builder = std::stringstream();
+        builder << s.name << ": " << formatFloat("%.2f", s.last) << " " << formatFloat("%.2f", s.min) << "/"
+                << formatFloat("%.2f", s.avg) << "/" << formatFloat("%.2f", s.max) << "ms";
+        font->RenderText(shader, builder.str(), 10, y, 0.5, glm::vec3(0.f));
+        y -= 20;
+    }
 }
 
 
@@ -1,9 +1,11 @@
 #include "../include/envSky.hpp"
+#include "../include/util/gpuProfiler.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 #include <cmath>
 
 EnvSky::EnvSky(const std::string &envMap, const glm::vec3 &_sunDir, float sunDist, float sunRadius) {
     sunShader = Shader("./shaders/sun.vert", "./shaders/sun.frag");
+    material = UniformBuffer<SunMaterial>({sunCol, 0.f});
 
     this->sunDir = glm::normalize(_sunDir);
     this->sunDist = sunDist;
@@ -35,10 +37,11 @@ EnvSky::EnvSky(const std::string &envMap, const glm::vec3 &_sunDir, float sunDis
     delete[] buff;
 }
     
-void EnvSky::show(const glm::mat4 &m_proj_view) const {
+void EnvSky::show(const FrameUniforms &frame) const {
+    GPU_SCOPE("sky");
     sunShader.use();
-    sunShader.setUniform("projection", m_proj_view);
-    sunShader.setUniform("sunColor", sunCol);
+    frame.bind(FRAME_UBO_BINDING);
+    material.bind(MATERIAL_UBO_BINDING);
 
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
@@ -52,6 +55,8 @@ void EnvSky::show(const glm::mat4 &m_proj_view) const {
 
 void EnvSky::setSunCol(const glm::vec3 &col) {
     this->sunCol = col;
+    material.getData().color = col;
+    material.upload();
 }
 
 float EnvSky::getSunAngle() const {
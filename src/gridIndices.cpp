@@ -0,0 +1,182 @@
+#include "../include/gridIndices.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+// Inverse of the bit interleaving, even bits of a Morton code
+static inline int compactBits(unsigned v) {
+    v &= 0x55555555u;
+    v = (v | (v >> 1)) & 0x33333333u;
+    v = (v | (v >> 2)) & 0x0f0f0f0fu;
+    v = (v | (v >> 4)) & 0x00ff00ffu;
+    v = (v | (v >> 8)) & 0x0000ffffu;
+    return v;
+}
+
+GridIndices::GridIndices(int n, int border, int patchCells, Layout layout, bool shortIndices) {
+    assert(n > 2 * border + 1 && patchCells > 0 && (patchCells & (patchCells - 1)) == 0);
+
+    this->n = n;
+    this->layout = layout;
+    // Largest local index is the far corner of a full patch
+    this->shortIndices = shortIndices && patchCells * n + patchCells < std::numeric_limits<GLushort>::max();
+    if (this->shortIndices)
+        build(shorts, border, patchCells);
+    else
+        build(ints, border, patchCells);
+}
+
+template<class T>
+void GridIndices::build(std::vector<T> &out, int border, int patchCells) {
+    const T restart = std::numeric_limits<T>::max();
+    int first = border, last = n - border - 1; // Cells [first; last)
+    int side = (n + patchCells - 1) / patchCells;
+
+    for (int pz = 0; pz < side; pz++) {
+        for (int px = 0; px < side; px++) {
+            int x0 = std::max(px * patchCells, first), x1 = std::min((px + 1) * patchCells, last);
+            int z0 = std::max(pz * patchCells, first), z1 = std::min((pz + 1) * patchCells, last);
+            if (x0 >= x1 || z0 >= z1)
+                continue;
+
+            Patch p;
+            p.firstIndex = out.size();
+            p.baseVertex = z0 * n + x0;
+            p.nodes[0] = x0;
+            p.nodes[1] = z0;
+            p.nodes[2] = x1;
+            p.nodes[3] = z1;
+
+            // Node (x, z) of the grid relative to the first node of the patch
+            auto at = [&](int x, int z) { return (T) ((z - z0) * n + (x - x0)); };
+            auto cell = [&](int x, int z) {
+                out.push_back(at(x, z));
+                out.push_back(at(x + 1, z));
+                out.push_back(at(x + 1, z + 1));
+                out.push_back(at(x, z));
+                out.push_back(at(x + 1, z + 1));
+                out.push_back(at(x, z + 1));
+            };
+
+            switch (layout) {
+            case Layout::ROWS:
+                for (int z = z0; z < z1; z++)
+                    for (int x = x0; x < x1; x++)
+                        cell(x, z);
+                break;
+            case Layout::MORTON:
+                // Codes of the whole aligned patch, cells cut by the border are skipped
+                for (unsigned code = 0; code < (unsigned) (patchCells * patchCells); code++) {
+                    int x = px * patchCells + compactBits(code);
+                    int z = pz * patchCells + compactBits(code >> 1);
+                    if (x >= x0 && x < x1 && z >= z0 && z < z1)
+                        cell(x, z);
+                }
+                break;
+            case Layout::STRIPS:
+                // Lower node first keeps the diagonals of the triangle list
+                for (int bx = x0; bx < x1; bx += GRID_STRIP_CELLS) {
+                    int bx1 = std::min(bx + GRID_STRIP_CELLS, x1);
+                    for (int z = z0; z < z1; z++) {
+                        for (int x = bx; x <= bx1; x++) {
+                            out.push_back(at(x, z + 1));
+                            out.push_back(at(x, z));
+                        }
+                        out.push_back(restart);
+                    }
+                }
+                out.pop_back();
+                break;
+            }
+
+            p.count = out.size() - p.firstIndex;
+            patches.push_back(p);
+        }
+    }
+}
+
+template<class T>
+GridIndices::CacheStats GridIndices::simulate(const std::vector<T> &in, int cacheSize) const {
+    const T restart = std::numeric_limits<T>::max();
+    CacheStats stats = { 0, 0, 0 };
+    std::vector<GLint> fifo(cacheSize, -1);
+    int head = 0;
+
+    for (const Patch &p : patches) {
+        size_t strip = 0; // Indices since the last restart
+        for (size_t i = p.firstIndex; i < p.firstIndex + p.count; i++) {
+            if (layout == Layout::STRIPS && in[i] == restart) {
+                strip = 0;
+                continue;
+            }
+            if (layout == Layout::STRIPS ? ++strip >= 3 : i % 3 == 2)
+                stats.triangles++;
+
+            GLint v = p.baseVertex + (GLint) in[i];
+            stats.references++;
+            if (std::find(fifo.begin(), fifo.end(), v) == fifo.end()) {
+                stats.misses++;
+                fifo[head] = v;
+                head = (head + 1) % cacheSize;
+            }
+        }
+    }
+    return stats;
+}
+
+GridIndices::CacheStats GridIndices::simulateCache(int cacheSize) const {
+    assert(cacheSize > 0);
+    return shortIndices ? simulate(shorts, cacheSize) : simulate(ints, cacheSize);
+}
+
+double GridIndices::CacheStats::getHitRate() const {
+    return references ? 1.0 - (double) misses / references : 0.0;
+}
+
+double GridIndices::CacheStats::getACMR() const {
+    return triangles ? (double) misses / triangles : 0.0;
+}
+
+GLenum GridIndices::getMode() const {
+    return layout == Layout::STRIPS ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+}
+
+GLenum GridIndices::getType() const {
+    return shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+const void* GridIndices::getData() const {
+    return shortIndices ? (const void*) shorts.data() : (const void*) ints.data();
+}
+
+size_t GridIndices::getCount() const {
+    return shortIndices ? shorts.size() : ints.size();
+}
+
+size_t GridIndices::getSize() const {
+    return getCount() * (shortIndices ? sizeof(GLushort) : sizeof(GLuint));
+}
+
+const std::vector<GridIndices::Patch>& GridIndices::getPatches() const {
+    return patches;
+}
+
+GridIndices::Layout GridIndices::getLayout() const {
+    return layout;
+}
+
+bool GridIndices::isShort() const {
+    return shortIndices;
+}
+
+const char* GridIndices::getName(Layout layout) {
+    switch (layout) {
+    case Layout::MORTON:
+        return "morton";
+    case Layout::STRIPS:
+        return "strips";
+    default:
+        return "rows";
+    }
+}
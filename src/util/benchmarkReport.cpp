@@ -0,0 +1,130 @@
+#include "../../include/util/benchmarkReport.hpp"
+#include "../../include/util/utility.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+BenchmarkReport::Summary BenchmarkReport::summarize(std::vector<float> samples) {
+    Summary s = { samples.size(), 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+    if (samples.empty())
+        return s;
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&](float p) {
+        size_t i = (size_t) std::ceil(p * samples.size());
+        return samples[std::min(std::max<size_t>(i, 1), samples.size()) - 1];
+    };
+    float sum = 0.f;
+    for (float x : samples)
+        sum += x;
+    s.min = samples.front();
+    s.avg = sum / samples.size();
+    s.p50 = rank(0.50f);
+    s.p95 = rank(0.95f);
+    s.p99 = rank(0.99f);
+    s.max = samples.back();
+    return s;
+}
+
+void BenchmarkReport::addTo(std::vector<Series> &series, const std::string &name, float ms) {
+    for (Series &s : series) {
+        if (s.name == name) {
+            s.samples.push_back(ms);
+            return;
+        }
+    }
+    series.push_back({ name, { ms } });
+}
+
+void BenchmarkReport::setInfo(const std::string &key, const std::string &value, bool number) {
+    for (Info &i : info) {
+        if (i.key == key) {
+            i.value = value;
+            i.number = number;
+            return;
+        }
+    }
+    info.push_back({ key, value, number });
+}
+
+void BenchmarkReport::setInfo(const std::string &key, const std::string &value) {
+    setInfo(key, value, false);
+}
+
+void BenchmarkReport::setInfo(const std::string &key, const char *value) {
+    setInfo(key, std::string(value), false);
+}
+
+void BenchmarkReport::setInfo(const std::string &key, double value) {
+    if (!std::isfinite(value))
+        setInfo(key, "null", true);
+    else {
+        std::ostringstream text;
+        if (value == std::floor(value) && std::fabs(value) < 1e15)
+            text << std::fixed << std::setprecision(0) << value;
+        else
+            text << std::setprecision(6) << value;
+        setInfo(key, text.str(), true);
+    }
+}
+
+void BenchmarkReport::addCpu(const std::string &name, float ms) {
+    addTo(cpu, name, ms);
+}
+
+void BenchmarkReport::addGpu(const std::string &name, const std::vector<float> &samples) {
+    for (float ms : samples)
+        addTo(gpu, name, ms);
+}
+
+void BenchmarkReport::print(std::ostream &os) const {
+    auto printSeries = [&](const char *group, const std::vector<Series> &series) {
+        for (const Series &s : series) {
+            Summary sm = summarize(s.samples);
+            os << group << " " << std::left << std::setw(16) << s.name << std::right
+               << " p50 " << formatFloat("%7.2f", sm.p50)
+               << "  p95 " << formatFloat("%7.2f", sm.p95)
+               << "  p99 " << formatFloat("%7.2f", sm.p99)
+               << "  avg " << formatFloat("%7.2f", sm.avg)
+               << "  max " << formatFloat("%7.2f", sm.max) << " ms" << std::endl;
+        }
+    };
+    printSeries("CPU", cpu);
+    printSeries("GPU", gpu);
+}
+
+bool BenchmarkReport::write(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Cannot write benchmark report to " << path << std::endl;
+        return false;
+    }
+
+    auto writeSeries = [&](const std::vector<Series> &series) {
+        out << "{";
+        for (size_t i = 0; i < series.size(); i++) {
+            Summary sm = summarize(series[i].samples);
+            out << (i ? ",\n    " : "\n    ") << "\"" << series[i].name << "\": {"
+                << "\"count\": " << sm.count
+                << ", \"min\": " << sm.min << ", \"avg\": " << sm.avg
+                << ", \"p50\": " << sm.p50 << ", \"p95\": " << sm.p95
+                << ", \"p99\": " << sm.p99 << ", \"max\": " << sm.max << "}";
+        }
+        out << (series.empty() ? "}" : "\n  }");
+    };
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"info\": {";
+    for (size_t i = 0; i < info.size(); i++)
+        out << (i ? ",\n    " : "\n    ") << "\"" << info[i].key << "\": "
+            << (info[i].number ? info[i].value : "\"" + info[i].value + "\"");
+    out << (info.empty() ? "}" : "\n  }") << ",\n  \"cpu\": ";
+    writeSeries(cpu);
+    out << ",\n  \"gpu\": ";
+    writeSeries(gpu);
+    out << "\n}\n";
+    return true;
+}
@@ -0,0 +1,76 @@
+#include "../../include/util/cameraPath.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+template<class T>
+static T catmullRom(const T &p0, const T &p1, const T &p2, const T &p3, float t) {
+    float t2 = t * t, t3 = t2 * t;
+    return 0.5f * (2.f * p1 + (p2 - p0) * t +
+                   (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 +
+                   (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+}
+
+CameraPath::CameraPath(const std::vector<Key> &keys) : keys(keys) {
+    std::stable_sort(this->keys.begin(), this->keys.end(),
+                     [](const Key &a, const Key &b) { return a.time < b.time; });
+}
+
+CameraPath CameraPath::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot open camera path " + path);
+
+    std::vector<Key> keys;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        std::istringstream ss(line);
+        Key k;
+        if (!(ss >> k.time >> k.pos.x >> k.pos.y >> k.pos.z >> k.yaw >> k.pitch))
+            throw std::runtime_error("Bad camera path key in " + path + ": " + line);
+        keys.push_back(k);
+    }
+    if (keys.empty())
+        throw std::runtime_error("Camera path is empty: " + path);
+    return CameraPath(keys);
+}
+
+bool CameraPath::empty() const {
+    return keys.empty();
+}
+
+float CameraPath::getDuration() const {
+    return keys.empty() ? 0.f : keys.back().time - keys.front().time;
+}
+
+Camera CameraPath::at(float time) const {
+    Camera cam;
+    if (keys.empty())
+        return cam;
+
+    size_t i = std::upper_bound(keys.begin(), keys.end(), time,
+                                [](float t, const Key &k) { return t < k.time; }) - keys.begin();
+    if (i == 0 || i == keys.size()) {
+        const Key &k = keys[i == 0 ? 0 : keys.size() - 1];
+        cam.pos = k.pos;
+        cam.setViewDeg(k.yaw, k.pitch);
+        return cam;
+    }
+
+    // Segment k1..k2, the end keys are repeated as the outer control points
+    const Key &k0 = keys[i > 1 ? i - 2 : i - 1];
+    const Key &k1 = keys[i - 1];
+    const Key &k2 = keys[i];
+    const Key &k3 = keys[i + 1 < keys.size() ? i + 1 : i];
+    float t = (time - k1.time) / std::max(k2.time - k1.time, 1e-6f);
+
+    cam.pos = catmullRom(k0.pos, k1.pos, k2.pos, k3.pos, t);
+    cam.setViewDeg(catmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, t),
+                   catmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, t));
+    return cam;
+}
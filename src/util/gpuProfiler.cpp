@@ -0,0 +1,151 @@
+#include "../../include/util/gpuProfiler.hpp"
+#include "../../include/util/tracer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+GpuProfiler& GpuProfiler::get() {
+    static GpuProfiler profiler;
+    return profiler;
+}
+
+void GpuProfiler::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    // Results of a half-recorded frame are useless
+    for (Frame &frame : frames) {
+        frame.records.clear();
+        frame.used = 0;
+    }
+    open.clear();
+}
+
+bool GpuProfiler::isEnabled() const {
+    return enabled;
+}
+
+void GpuProfiler::setHistory(bool keep) {
+    keepHistory = keep;
+    for (Scope &s : scopes)
+        s.history.clear();
+}
+
+GLuint GpuProfiler::nextQuery() {
+    Frame &frame = frames[current];
+    if (frame.used == frame.queries.size()) {
+        GLuint id;
+        glGenQueries(1, &id);
+        frame.queries.push_back(id);
+    }
+    return frame.queries[frame.used++];
+}
+
+int GpuProfiler::getScope(const char *name) {
+    for (size_t i = 0; i < scopes.size(); i++)
+        if (strcmp(scopes[i].name, name) == 0)
+            return i;
+    scopes.emplace_back();
+    scopes.back().name = name;
+    return scopes.size() - 1;
+}
+
+// Adds the frame to the statistics if the GPU is done with it, otherwise drops it
+void GpuProfiler::collect(Frame &frame) {
+    if (frame.records.empty())
+        return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(frame.records.back().end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+        Tracer &tracer = Tracer::get();
+        std::vector<float> sums(scopes.size(), -1.f);
+        for (const Record &r : frame.records) {
+            GLuint64 begin, end;
+            glGetQueryObjectui64v(r.begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(r.end, GL_QUERY_RESULT, &end);
+            sums[r.scope] = std::max(sums[r.scope], 0.f) + (end - begin) * 1e-6f;
+            if (frame.traced)
+                tracer.gpuEvent(scopes[r.scope].name, begin, end);
+        }
+        for (size_t i = 0; i < scopes.size(); i++) {
+            if (sums[i] < 0.f)
+                continue;
+            Scope &s = scopes[i];
+            s.samples[s.head] = sums[i];
+            s.head = (s.head + 1) % GPU_PROFILER_WINDOW;
+            s.count = std::min(s.count + 1, GPU_PROFILER_WINDOW);
+            if (keepHistory)
+                s.history.push_back(sums[i]);
+        }
+    }
+    frame.records.clear();
+    frame.used = 0;
+}
+
+void GpuProfiler::beginFrame() {
+    if (!enabled)
+        return;
+    current = (current + 1) % GPU_PROFILER_FRAMES;
+    collect(frames[current]);
+    frames[current].traced = Tracer::get().isRecording();
+    open.clear();
+}
+
+void GpuProfiler::begin(const char *name) {
+    if (!enabled)
+        return;
+    Frame &frame = frames[current];
+    Record r;
+    r.scope = getScope(name);
+    r.begin = nextQuery();
+    r.end = nextQuery();
+    glQueryCounter(r.begin, GL_TIMESTAMP);
+    open.push_back(frame.records.size());
+    frame.records.push_back(r);
+}
+
+void GpuProfiler::end() {
+    if (!enabled || open.empty())
+        return;
+    Frame &frame = frames[current];
+    glQueryCounter(frame.records[open.back()].end, GL_TIMESTAMP);
+    open.pop_back();
+}
+
+void GpuProfiler::flush() {
+    if (!enabled)
+        return;
+    glFinish();
+    // Oldest first, the current frame is the last one
+    for (int i = 1; i <= GPU_PROFILER_FRAMES; i++)
+        collect(frames[(current + i) % GPU_PROFILER_FRAMES]);
+    open.clear();
+}
+
+std::vector<GpuProfiler::Stats> GpuProfiler::getStats() const {
+    std::vector<Stats> res;
+    for (const Scope &s : scopes) {
+        if (s.count == 0)
+            continue;
+        Stats st;
+        st.name = s.name;
+        st.last = s.samples[(s.head + GPU_PROFILER_WINDOW - 1) % GPU_PROFILER_WINDOW];
+        st.min = st.max = st.last;
+        float sum = 0.f;
+        for (int i = 0; i < s.count; i++) {
+            st.min = std::min(st.min, s.samples[i]);
+            st.max = std::max(st.max, s.samples[i]);
+            sum += s.samples[i];
+        }
+        st.avg = sum / s.count;
+        res.push_back(st);
+    }
+    return res;
+}
+
+std::vector<GpuProfiler::History> GpuProfiler::getHistory() const {
+    std::vector<History> res;
+    for (const Scope &s : scopes)
+        if (!s.history.empty())
+            res.push_back({ s.name, s.history });
+    return res;
+}
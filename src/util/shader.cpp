@@ -4,11 +4,20 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
 #include <dirent.h>
+#include <sys/stat.h>
 
 #include <glm/gtc/type_ptr.hpp>
 
 #define SHADER_INFOLOG_BUFSIZE 1024
+#define SHADER_CACHE_DIR "./shader_cache"
+#define SHADER_INCLUDE_DEPTH 16
+
+bool Shader::binaryCache = true;
+bool Shader::deferredCompile = false;
 
 inline std::string getShaderTypeName(Shader::ShaderType type) {
     switch (type) {
@@ -38,14 +47,70 @@ static std::string readFile(const std::string &path) {
     return ss.str();
 }
 
-GLuint Shader::compileShader(ShaderType type, const std::string &path) const {
-    std::string src = readFile(path);
-    GLint srcLen = src.length();
-    const GLchar *ptr = src.c_str();
-    GLuint shaderId = glCreateShader(static_cast<GLenum>(type));
+// Replaces #include "file" lines with the file, paths are relative to the including shader
+static std::string loadSource(const std::string &path, int depth = 0) {
+    if (depth > SHADER_INCLUDE_DEPTH)
+        throw std::runtime_error("Shader include depth exceeded: " + path);
+
+    std::string dir = path.substr(0, path.find_last_of('/') + 1);
+    std::stringstream in(readFile(path));
+    std::string res, line;
+    while (std::getline(in, line)) {
+        size_t pos = line.find_first_not_of(" \t");
+        if (pos != std::string::npos && line.compare(pos, 8, "#include") == 0) {
+            size_t begin = line.find('"', pos);
+            size_t end = line.find('"', begin + 1);
+            if (begin == std::string::npos || end == std::string::npos)
+                throw std::runtime_error("Bad shader include in " + path + ": " + line);
+            std::string includePath = dir + line.substr(begin + 1, end - begin - 1);
+            if (!std::ifstream(includePath))
+                throw std::runtime_error("Shader include not found: " + includePath);
+            res += loadSource(includePath, depth + 1);
+        }
+        else
+            res += line + "\n";
+    }
+    return res;
+}
+
+static std::string insertDefines(const std::string &src, const std::map<std::string, std::string> &defines) {
+    if (defines.empty())
+        return src;
+
+    std::string lines;
+    for (const auto &[name, value] : defines)
+        lines += "#define " + name + " " + value + "\n";
+
+    size_t pos = src.find("#version");
+    pos = pos == std::string::npos ? 0 : src.find('\n', pos) + 1;
+    return src.substr(0, pos) + lines + src.substr(pos);
+}
+
+// 64-bit FNV-1a
+static uint64_t hashString(const std::string &str, uint64_t hash = 0xcbf29ce484222325ull) {
+    for (unsigned char c : str) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static std::string getGlString(GLenum name) {
+    const GLubyte *str = glGetString(name);
+    return str ? reinterpret_cast<const char*>(str) : "";
+}
+
+// Only submits the source, the status is checked in checkShader
+GLuint Shader::compileShader(const Stage &stage) const {
+    GLint srcLen = stage.source.length();
+    const GLchar *ptr = stage.source.c_str();
+    GLuint shaderId = glCreateShader(static_cast<GLenum>(stage.type));
     glShaderSource(shaderId, 1, &ptr, &srcLen);
     glCompileShader(shaderId);
+    return shaderId;
+}
 
+void Shader::checkShader(GLuint shaderId, const Stage &stage) const {
     GLint succ;
     glGetShaderiv(shaderId, GL_COMPILE_STATUS, &succ);
     if (!succ) {
@@ -53,19 +118,16 @@ GLuint Shader::compileShader(ShaderType type, const std::string &path) const {
         GLsizei logSize;
         glGetShaderInfoLog(shaderId, SHADER_INFOLOG_BUFSIZE, &logSize, infoLog);
         std::cerr << "Shader compile error:" << std::endl ;
-        std::cerr << "Type: " << getShaderTypeName(type) << " Path: " << path << std::endl;
+        std::cerr << "Type: " << getShaderTypeName(stage.type) << " Path: " << stage.path << std::endl;
         std::cerr << infoLog << std::endl;
         if (logSize >= SHADER_INFOLOG_BUFSIZE)
             std::cerr << "======== infolog cutted ========" << std::endl;
-        throw std::runtime_error(getShaderTypeName(type) + " shader compile error");
+        throw std::runtime_error(getShaderTypeName(stage.type) + " shader compile error");
     }
-
-    return shaderId;
 }
 
-void Shader::linkProgram(GLuint programId) const {
+void Shader::checkProgram() const {
     GLint succ;
-    glLinkProgram(programId);
     glGetProgramiv(programId, GL_LINK_STATUS, &succ);
     if (!succ) {
         GLchar infoLog[SHADER_INFOLOG_BUFSIZE];
@@ -78,38 +140,130 @@ void Shader::linkProgram(GLuint programId) const {
     }
 }
 
-Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath) {
-    GLuint vertexId = vertexPath.empty() ? 0 : compileShader(ShaderType::VERT, vertexPath);
-    GLuint fragmentId = fragmentPath.empty() ? 0 : compileShader(ShaderType::FRAG, fragmentPath);
-    GLuint geometryId = geometryPath.empty() ? 0 : compileShader(ShaderType::GEOM, geometryPath);
+// Binary file layout: GLenum format, then the program binary
+bool Shader::loadBinary(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+
+    GLenum format;
+    in.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if (!in)
+        return false;
+    std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (binary.empty())
+        return false;
 
+    glProgramBinary(programId, format, binary.data(), binary.size());
+    GLint succ;
+    glGetProgramiv(programId, GL_LINK_STATUS, &succ);
+    return succ;
+}
+
+void Shader::saveBinary(const std::string &path) const {
+    GLint length = 0;
+    glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(programId, length, &length, &format, binary.data());
+
+    mkdir(SHADER_CACHE_DIR, 0755);
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return;
+    out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    out.write(binary.data(), length);
+}
+
+void Shader::buildProgram(const std::vector<Stage> &stages) {
     programId = glCreateProgram();
 
-    if (!vertexPath.empty())
-        glAttachShader(programId, vertexId);
-    if (!fragmentPath.empty())
-        glAttachShader(programId, fragmentId);
-    if (!geometryPath.empty())
-        glAttachShader(programId, geometryId);
+    GLint formats = 0;
+    if (binaryCache)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    // Binaries are only valid for the driver that produced them
+    std::string cachePath;
+    if (formats > 0) {
+        uint64_t hash = hashString(getGlString(GL_VENDOR) + getGlString(GL_RENDERER) + getGlString(GL_VERSION));
+        for (const auto &stage : stages) {
+            hash = hashString(getShaderTypeName(stage.type), hash);
+            hash = hashString(stage.source, hash);
+        }
+        std::stringstream name;
+        name << SHADER_CACHE_DIR << "/" << std::hex << hash << ".bin";
+        cachePath = name.str();
+
+        if (loadBinary(cachePath))
+            return;
+        // Rejected binary leaves the program unlinked, start over from source
+        glDeleteProgram(programId);
+        programId = glCreateProgram();
+        glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // Statuses are not queried here, so the driver may keep compiling in the background
+    pending = std::make_shared<Pending>();
+    pending->stages = stages;
+    pending->cachePath = cachePath;
+    for (const auto &stage : stages) {
+        pending->shaderIds.push_back(compileShader(stage));
+        glAttachShader(programId, pending->shaderIds.back());
+    }
+    glLinkProgram(programId);
 
-    linkProgram(programId);
+    if (!deferredCompile)
+        finish();
+}
 
+void Shader::finish() const {
+    if (pending && !pending->done) {
+        for (size_t i = 0; i < pending->stages.size(); i++)
+            checkShader(pending->shaderIds[i], pending->stages[i]);
+        checkProgram();
+
+        for (GLuint id : pending->shaderIds)
+            glDeleteShader(id);
+        if (!pending->cachePath.empty())
+            saveBinary(pending->cachePath);
+        pending->done = true;
+    }
+
+    if (!uniformsCached) {
+        cacheUniforms();
+        uniformsCached = true;
+    }
+}
+
+Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath) {
+    std::vector<Stage> stages;
     if (!vertexPath.empty())
-        glDeleteShader(vertexId);
+        stages.push_back({ ShaderType::VERT, vertexPath, loadSource(vertexPath) });
     if (!fragmentPath.empty())
-        glDeleteShader(fragmentId);
+        stages.push_back({ ShaderType::FRAG, fragmentPath, loadSource(fragmentPath) });
     if (!geometryPath.empty())
-        glDeleteShader(geometryId);
+        stages.push_back({ ShaderType::GEOM, geometryPath, loadSource(geometryPath) });
 
+    buildProgram(stages);
     initialized = true;
 }
 
-Shader::Shader(const std::string &computePath) {
-    GLuint compId = compileShader(ShaderType::COMP, computePath);
-    programId = glCreateProgram();
-    glAttachShader(programId, compId);
-    linkProgram(programId);
-    glDeleteShader(compId);
+Shader::Shader(const std::string &vertexPath, const std::string &tessControlPath,
+               const std::string &tessEvalPath, const std::string &fragmentPath) {
+    buildProgram({
+        { ShaderType::VERT, vertexPath, loadSource(vertexPath) },
+        { ShaderType::TESC, tessControlPath, loadSource(tessControlPath) },
+        { ShaderType::TESE, tessEvalPath, loadSource(tessEvalPath) },
+        { ShaderType::FRAG, fragmentPath, loadSource(fragmentPath) },
+    });
+    initialized = true;
+}
+
+Shader::Shader(const std::string &computePath, const std::map<std::string, std::string> &defines) {
+    buildProgram({ { ShaderType::COMP, computePath, insertDefines(loadSource(computePath), defines) } });
     initialized = true;
 }
 
@@ -117,62 +271,154 @@ Shader::Shader() {
     initialized = false;
 }
 
+void Shader::cacheUniforms() const {
+    GLint count, maxLength;
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> buff(maxLength + 1);
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(programId, i, buff.size(), &length, &size, &type, buff.data());
+        std::string name(buff.data(), length);
+
+        // Arrays are reported as name[0], every element gets its own entry
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            name.erase(name.size() - 3);
+            for (GLint j = 0; j < size; j++) {
+                std::string elem = name + "[" + std::to_string(j) + "]";
+                uniforms[elem] = glGetUniformLocation(programId, elem.c_str());
+            }
+        }
+
+        // Members of uniform blocks have no location
+        GLint location = glGetUniformLocation(programId, name.c_str());
+        if (location >= 0)
+            uniforms[name] = location;
+    }
+}
+
+GLint Shader::getUniformLocation(const std::string &name) const {
+    finish();
+    auto it = uniforms.find(name);
+    if (it != uniforms.end())
+        return it->second;
+
+    if (reported.insert(name).second)
+        std::cerr << "Unknown uniform \"" << name << "\" in program " << programId << std::endl;
+    return -1;
+}
+
+void Shader::setBinaryCache(bool enabled) {
+    binaryCache = enabled;
+}
+
+void Shader::setDeferredCompile(bool enabled) {
+    deferredCompile = enabled;
+    if (!enabled)
+        return;
+
+    // Let the driver use as many compiler threads as it wants
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else if (GLEW_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+}
+
 //
 
 void Shader::use() const {
+    finish();
     glUseProgram(programId);
 }
 
 GLuint Shader::getProgramId() const {
+    finish();
     return programId;
 }
 
 // Uniforms
 
 void Shader::setUniform(const std::string &name, bool val) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform1i(uniformLoc, val ? 1 : 0);
 }
 
 void Shader::setUniform(const std::string &name, GLint val) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform1i(uniformLoc, val);
 }
 
 void Shader::setUniform(const std::string &name, GLfloat val) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform1f(uniformLoc, val);
 }
 
 void Shader::setUniform(const std::string &name, GLfloat v1, GLfloat v2) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform2f(uniformLoc, v1, v2);
 }
 void Shader::setUniform(const std::string &name, GLfloat v1, GLfloat v2, GLfloat v3) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform3f(uniformLoc, v1, v2, v3);
 }
 void Shader::setUniform(const std::string &name, GLfloat v1, GLfloat v2, GLfloat v3, GLfloat v4) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform4f(uniformLoc, v1, v2, v3, v4);
 }
 
 void Shader::setUniform(const std::string &name, const glm::vec2 &val) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform2f(uniformLoc, val.x, val.y);
 }
 
 void Shader::setUniform(const std::string &name, const glm::vec3 &val) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform3f(uniformLoc, val.x, val.y, val.z);
 }
 
 void Shader::setUniform(const std::string &name, const glm::vec4 &val) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniform4f(uniformLoc, val[0], val[1], val[2], val[3]);
 }
 
 void Shader::setUniform(const std::string &name, const glm::mat4 &val) const {
-    GLuint uniformLoc = glGetUniformLocation(programId, name.c_str());
+    GLint uniformLoc = getUniformLocation(name);
     glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(val));
 }
+
+// Typed handles
+
+template<> void Uniform<bool>::set(const bool &val) const {
+    glUniform1i(location, val ? 1 : 0);
+}
+
+template<> void Uniform<GLint>::set(const GLint &val) const {
+    glUniform1i(location, val);
+}
+
+template<> void Uniform<GLfloat>::set(const GLfloat &val) const {
+    glUniform1f(location, val);
+}
+
+template<> void Uniform<glm::vec2>::set(const glm::vec2 &val) const {
+    glUniform2f(location, val.x, val.y);
+}
+
+template<> void Uniform<glm::ivec2>::set(const glm::ivec2 &val) const {
+    glUniform2i(location, val.x, val.y);
+}
+
+template<> void Uniform<glm::vec3>::set(const glm::vec3 &val) const {
+    glUniform3f(location, val.x, val.y, val.z);
+}
+
+template<> void Uniform<glm::vec4>::set(const glm::vec4 &val) const {
+    glUniform4f(location, val[0], val[1], val[2], val[3]);
+}
+
+template<> void Uniform<glm::mat4>::set(const glm::mat4 &val) const {
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(val));
+}
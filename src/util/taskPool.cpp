@@ -0,0 +1,141 @@
+#include "../../include/util/taskPool.hpp"
+
+#include <algorithm>
+
+// Pool whose task the current thread is running, used to detect nested calls
+static thread_local const TaskPool *currentPool = nullptr;
+
+TaskPool::TaskPool(int threads) {
+    remaining = 0;
+    generation = 0;
+    stop = false;
+    startWorkers(threads);
+}
+
+TaskPool::~TaskPool() {
+    stopWorkers();
+}
+
+void TaskPool::startWorkers(int threads) {
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    stop = false;
+    for (int i = 0; i < threads; i++)
+        queues.push_back(new Queue());
+    // Queue 0 belongs to the thread calling parallelFor
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&TaskPool::workerLoop, this, i, generation);
+}
+
+void TaskPool::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stop = true;
+    }
+    wakeCv.notify_all();
+    for (auto &t : workers)
+        t.join();
+    workers.clear();
+
+    for (auto *q : queues)
+        delete q;
+    queues.clear();
+}
+
+void TaskPool::setThreadCount(int threads) {
+    stopWorkers();
+    startWorkers(threads);
+}
+
+int TaskPool::getThreadCount() const {
+    return queues.size();
+}
+
+void TaskPool::workerLoop(int index, unsigned seen) {
+    currentPool = this;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCv.wait(lock, [&] { return stop || generation != seen; });
+            if (stop)
+                return;
+            seen = generation;
+        }
+        runUntilDone(index);
+    }
+}
+
+void TaskPool::push(int index, const Task &task) {
+    Queue *q = queues[index];
+    std::lock_guard<std::mutex> lock(q->mutex);
+    q->tasks.push_back(task);
+}
+
+bool TaskPool::pop(int index, Task &task) {
+    Queue *q = queues[index];
+    std::lock_guard<std::mutex> lock(q->mutex);
+    if (q->tasks.empty())
+        return false;
+    task = q->tasks.back();
+    q->tasks.pop_back();
+    return true;
+}
+
+bool TaskPool::steal(int index, Task &task) {
+    int count = queues.size();
+    for (int i = 1; i < count; i++) {
+        Queue *q = queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(q->mutex);
+        if (!q->tasks.empty()) {
+            task = q->tasks.front();
+            q->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Keeps the first half, the other one goes to the own queue for others to steal
+void TaskPool::execute(int index, Task task) {
+    while (task.end - task.begin > task.grain) {
+        int mid = task.begin + (task.end - task.begin) / 2;
+        push(index, { task.func, mid, task.end, task.grain });
+        task.end = mid;
+    }
+    (*task.func)(task.begin, task.end);
+    remaining.fetch_sub(task.end - task.begin, std::memory_order_acq_rel);
+}
+
+void TaskPool::runUntilDone(int index) {
+    Task task;
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (pop(index, task) || steal(index, task))
+            execute(index, task);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void TaskPool::parallelFor(int count, int grain, const RangeFunc &func) {
+    if (count <= 0)
+        return;
+    grain = std::max(grain, 1);
+    if (workers.empty() || count <= grain || currentPool == this) {
+        func(0, count);
+        return;
+    }
+
+    const TaskPool *prevPool = currentPool;
+    currentPool = this;
+    remaining.store(count, std::memory_order_relaxed);
+    push(0, { &func, 0, count, grain });
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        generation++;
+    }
+    wakeCv.notify_all();
+
+    runUntilDone(0);
+    currentPool = prevPool;
+}
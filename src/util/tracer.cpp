@@ -0,0 +1,127 @@
+#include "../../include/util/tracer.hpp"
+#include "../../include/util/gpuProfiler.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+Tracer& Tracer::get() {
+    static Tracer tracer;
+    return tracer;
+}
+
+int64_t Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Tracer::Tracer() {
+    events = new Event[TRACE_CAPACITY];
+    count = 0;
+    recording = false;
+}
+
+Tracer::~Tracer() {
+    delete[] events;
+}
+
+void Tracer::capture(long first, long frames, const std::string &path) {
+    if (state != State::IDLE || frames <= 0)
+        return;
+    this->firstFrame = first < 0 ? frame + 1 : first;
+    this->endFrame = firstFrame + frames;
+    this->path = path;
+    state = State::WAITING;
+}
+
+bool Tracer::isBusy() const {
+    return state != State::IDLE;
+}
+
+void Tracer::start() {
+    GpuProfiler &profiler = GpuProfiler::get();
+    profilerWasEnabled = profiler.isEnabled();
+    if (!profilerWasEnabled)
+        profiler.setEnabled(true);
+
+    // Both clocks are read back to back, the error is the latency of one query
+    GLint64 gpuTime;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    gpuOffset = now() - gpuTime;
+
+    count = 0;
+    startTime = now();
+    recording = true;
+    state = State::RECORDING;
+}
+
+void Tracer::beginFrame() {
+    frame++;
+    switch (state) {
+    case State::WAITING:
+        if (frame >= firstFrame)
+            start();
+        break;
+    case State::RECORDING:
+        if (frame >= endFrame) {
+            recording = false;
+            drainFrames = GPU_PROFILER_FRAMES + 1;
+            state = State::DRAINING;
+        }
+        break;
+    case State::DRAINING:
+        if (--drainFrames == 0) {
+            write();
+            if (!profilerWasEnabled)
+                GpuProfiler::get().setEnabled(false);
+            state = State::IDLE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void Tracer::cpuEvent(const char *name, int64_t begin, int64_t end) {
+    size_t i = count.fetch_add(1, std::memory_order_relaxed);
+    if (i < TRACE_CAPACITY)
+        events[i] = { name, false, begin, end };
+}
+
+// GPU results of the captured frames arrive a few frames late, GpuProfiler marks them
+void Tracer::gpuEvent(const char *name, GLuint64 begin, GLuint64 end) {
+    if (state != State::RECORDING && state != State::DRAINING)
+        return;
+    size_t i = count.fetch_add(1, std::memory_order_relaxed);
+    if (i < TRACE_CAPACITY)
+        events[i] = { name, true, (int64_t)begin + gpuOffset, (int64_t)end + gpuOffset };
+}
+
+void Tracer::write() const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Cannot write trace to " << path << std::endl;
+        return;
+    }
+
+    size_t n = std::min<size_t>(count, TRACE_CAPACITY);
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    for (size_t i = 0; i < n; i++) {
+        const Event &e = events[i];
+        out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << (e.gpu ? "gpu" : "cpu")
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (e.gpu ? 1 : 0)
+            << ",\"ts\":" << (e.begin - startTime) * 1e-3
+            << ",\"dur\":" << (e.end - e.begin) * 1e-3 << "}";
+    }
+    out << "\n]}\n";
+
+    std::cout << "Trace of frames " << firstFrame << ".." << endFrame - 1 << " saved in " << path;
+    if (count > TRACE_CAPACITY)
+        std::cout << ", " << count - TRACE_CAPACITY << " events dropped";
+    std::cout << std::endl;
+}
@@ -0,0 +1,163 @@
+#include "../include/waterClipmap.hpp"
+#include "../include/util/gpuProfiler.hpp"
+
+#include <cassert>
+#include <vector>
+#include <cmath>
+
+template<class T>
+inline void push_quad(std::vector<T> &dst, T v00, T v10, T v11, T v01) {
+    dst.push_back(v00);
+    dst.push_back(v10);
+    dst.push_back(v11);
+    dst.push_back(v00);
+    dst.push_back(v11);
+    dst.push_back(v01);
+}
+
+// Floor division, cells left of the origin are negative
+static inline int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+WaterClipmap::WaterClipmap(int gridSize, int levels, float cellSize) {
+    assert(gridSize >= 8 && gridSize % 4 == 0);
+    assert(levels > 0);
+
+    this->gridSize = gridSize;
+    this->levels = levels;
+    this->cellSize = cellSize;
+
+    // One grid of vertices, levels differ by the origin and scale only
+    int side = gridSize + 1;
+    std::vector<GLint> vertices;
+    vertices.reserve(side * side * 2);
+    for (int z = 0; z < side; z++) {
+        for (int x = 0; x < side; x++) {
+            vertices.push_back(x);
+            vertices.push_back(z);
+        }
+    }
+
+    // Full grid for the finest level, for the rest the finer level cuts a hole of half the side.
+    // Both levels snap to their own double cell, so the hole is shifted by 0 or 1 cell per axis.
+    std::vector<GLuint> indices;
+    auto addMesh = [&](Range &range, int holeX, int holeZ, bool hole) {
+        range.offset = indices.size() * sizeof(GLuint);
+        int h0 = gridSize / 4, h1 = h0 + gridSize / 2;
+        for (int z = 0; z < gridSize; z++) {
+            for (int x = 0; x < gridSize; x++) {
+                if (hole && x >= h0 + holeX && x < h1 + holeX && z >= h0 + holeZ && z < h1 + holeZ)
+                    continue;
+                GLuint v = z * side + x;
+                push_quad<GLuint>(indices, v, v + 1, v + side + 1, v + side);
+            }
+        }
+        range.count = indices.size() - range.offset / sizeof(GLuint);
+    };
+    addMesh(full, 0, 0, false);
+    for (int i = 0; i < 4; i++)
+        addMesh(rings[i], i % 2, i / 2, true);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 2, GL_INT, 2 * sizeof(GLint), 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glGenSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    shader = Shader("./shaders/clipmap.vert", "./shaders/water.frag");
+}
+
+void WaterClipmap::show(const FrameUniforms &frame, const WaterMeshChunk &water, bool isMesh) const {
+    GPU_SCOPE("clipmap");
+
+    // Coarse levels read the maps through mipmaps
+    GLuint maps[] = { water.getNormalMap(), water.getDisplacementMap() };
+    for (GLuint map : maps) {
+        glBindTexture(GL_TEXTURE_2D, map);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    shader.use();
+    frame.bind(FRAME_UBO_BINDING);
+    water.bindMaterial();
+
+    shader.setUniform("is_mesh", isMesh);
+    if (isMesh)
+        shader.setUniform("mesh_color", 0.1, 0.1, 0.1);
+    shader.setUniform("normalMap", 0);
+    shader.setUniform("displacementMap", 2);
+    shader.setUniform("gridSize", gridSize);
+    shader.setUniform("cellSize", cellSize);
+    Uniform<GLint> uScale = shader.getUniform<GLint>("scale");
+    Uniform<glm::ivec2> uOrigin = shader.getUniform<glm::ivec2>("origin");
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, water.getNormalMap());
+    glBindSampler(0, sampler);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, water.getDisplacementMap());
+    glBindSampler(2, sampler);
+    glActiveTexture(GL_TEXTURE0);
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glPolygonMode(GL_FRONT_AND_BACK, isMesh ? GL_LINE : GL_FILL);
+
+    // Everything is in cells of the finest level, so shared edges of two levels are bit-exact
+    const glm::vec4 &eye = frame.getData().eye;
+    int eyeX = (int) std::floor(eye.x / cellSize);
+    int eyeZ = (int) std::floor(eye.z / cellSize);
+    int prevX = 0, prevZ = 0;
+
+    glBindVertexArray(vao);
+    for (int l = 0; l < levels; l++) {
+        int scale = 1 << l;
+        int originX = floorDiv(eyeX, 2 * scale) * 2 * scale - gridSize / 2 * scale;
+        int originZ = floorDiv(eyeZ, 2 * scale) * 2 * scale - gridSize / 2 * scale;
+
+        const Range *range = &full;
+        if (l > 0) {
+            int holeX = (prevX - originX) / scale - gridSize / 4;
+            int holeZ = (prevZ - originZ) / scale - gridSize / 4;
+            assert(holeX >= 0 && holeX <= 1 && holeZ >= 0 && holeZ <= 1);
+            range = &rings[holeX + 2 * holeZ];
+        }
+
+        uScale.set(scale);
+        uOrigin.set(glm::ivec2(originX, originZ));
+        glDrawElements(GL_TRIANGLES, range->count, GL_UNSIGNED_INT, (void*) range->offset);
+
+        prevX = originX;
+        prevZ = originZ;
+    }
+    glBindVertexArray(0);
+
+    glBindSampler(0, 0);
+    glBindSampler(2, 0);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+float WaterClipmap::getRange() const {
+    return gridSize / 2 * cellSize * (1 << (levels - 1));
+}
+
+int WaterClipmap::getVertexCount() const {
+    return (gridSize + 1) * (gridSize + 1);
+}
@@ -1,62 +1,53 @@
 #include "../include/waterMeshChunk.hpp"
 #include "../include/util/image.hpp"
 #include "../include/util/utility.hpp"
+#include "../include/util/gpuProfiler.hpp"
 #include <cmath>
 #include <iostream>
+#include <future>
 
 #define WG_SIZE 8
+#define MAX_WG_INVOCATIONS 1024 // Guaranteed by GL 4.3
 
 using namespace std::complex_literals;
 
 static constexpr bool useTrueRandom = true;
 static uint rseed = 3907355480; // 3060
+static bool isSeedFixed = false;
 
-template<class T>
-inline void push_tr(std::vector<T> &dst, T p1, T p2, T p3) {
-    dst.push_back(p1);
-    dst.push_back(p2);
-    dst.push_back(p3);
-}
-
-std::vector<std::pair<int, int> > WaterMeshChunk::getElements() const {
-    std::vector<std::pair<int, int> > tElements;
-    for (int zz = 4; zz < nodes - 5; zz++) {
-        for (int xx = 4; xx < nodes - 5; xx++) {
-            push_tr(tElements, { xx, zz }, { xx + 1, zz }, { xx + 1, zz + 1 });
-            push_tr(tElements, { xx, zz }, { xx + 1, zz + 1 }, { xx, zz + 1 });
-        }
-    }
-    return tElements;
-}
+std::map<WaterMeshChunk::VariantKey, WaterMeshChunk::Programs> WaterMeshChunk::variants;
 
-WaterMeshChunk::WaterMeshChunk(int dens, float size, int xs, int ys) {
+WaterMeshChunk::WaterMeshChunk(int dens, float size, int xs, int ys, Backend backend) {
     assert(dens > 0 && (dens & (dens - 1)) == 0);
     assert(size > 1e-4f);
 
     this->offset = glm::vec3(xs * dens * size, 0.f, ys * dens * size);
     this->nodes = dens;
     this->size = size;
+    this->backend = backend;
+    this->cpuOcean = backend == Backend::CPU ? new CpuOcean(nodes, size) : nullptr;
     this->fourierStages = log2i(nodes);
-
-    if constexpr(useTrueRandom) {
+    this->fftChannels = 2;
+    this->wgSize = WG_SIZE;
+    this->realTransform = true;
+    this->spectralNormals = false;
+    this->precision = Precision::FULL;
+    this->fftMode = nodes <= FFT_MAX_N ? FFTMode::SHARED : FFTMode::BUTTERFLY;
+    this->culling = false;
+    this->cullMargin = CULL_MARGIN;
+    this->vertexSource = VertexSource::BUFFER;
+    this->gridNodes = nodes;
+    this->indexLayout = GridIndices::Layout::STRIPS;
+    this->shortIndices = true;
+
+    if (useTrueRandom && !isSeedFixed) {
         rseed = (std::random_device())();
         std::cout << "Rd = " << rseed << std::endl;
     }
     gen = std::mt19937(rseed);
     dis = rand_distrib(0.f, 1.f);
 
-    // EBO computation
-    auto tElements = getElements();
-    elementsCount = tElements.size();
-    GLuint *ebuff = new GLuint[elementsCount];
-    size_t ind = 0;
-    for (const auto &e : tElements) {
-        int x = e.first;
-        int z = e.second;
-        ebuff[ind++] = z * nodes + x;
-    }
-
-    // Main buffers init
+    // Main buffers init, the EBO is filled by initGrid
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
@@ -66,14 +57,22 @@ WaterMeshChunk::WaterMeshChunk(int dens, float size, int xs, int ys) {
     glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * nodes * nodes * 3, nullptr, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
+    glGenVertexArrays(1, &gridVAO);
+    glGenBuffers(1, &gridVBO);
+    glBindVertexArray(gridVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 2, GL_INT, 2 * sizeof(GLint), 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * elementsCount, ebuff, GL_STATIC_DRAW);
 
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    delete[] ebuff;
+
+    initCulling();
+    initGrid();
 
     // Texture init
     glGenTextures(1, &normalMapID);
@@ -81,63 +80,263 @@ WaterMeshChunk::WaterMeshChunk(int dens, float size, int xs, int ys) {
     configGlTexture(GL_CLAMP_TO_EDGE, GL_LINEAR);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, nodes, nodes, 0, GL_RGBA, GL_FLOAT, nullptr);
     glBindTexture(GL_TEXTURE_2D, 0);
+    initDisplacementMap();
 
     // Shaders loading
     showShader = Shader("./shaders/water.vert", "./shaders/water.frag");
-    normShader = Shader("./shaders/norm.comp");
+    gridShader = Shader("./shaders/grid.vert", "./shaders/water.frag");
+    showUniforms = getShowUniforms(showShader, false);
+    gridUniforms = getShowUniforms(gridShader, true);
+    Material mat = {};
+    mat.gNodes = nodes * size;
+    material = UniformBuffer<Material>(mat);
+
+    if (backend == Backend::GPU) {
+        perlinShader = Shader("./shaders/perlin.comp", { { "WG_SIZE", std::to_string(WG_SIZE) } });
+
+        initCompute();
+
+        // Init debug
+        initDebug();
+    }
+}
+
+// Elements and culled patches of the drawn grid, the simulation grid or the flat one.
+// Also resets the draw commands, all patches are drawn until the next cull.
+void WaterMeshChunk::initGrid() {
+    int n = vertexSource == VertexSource::TEXTURE ? gridNodes : nodes;
+    GridIndices indices(n, 4, CULL_PATCH_CELLS, indexLayout, shortIndices);
+    indexMode = indices.getMode();
+    indexType = indices.getType();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.getSize(), indices.getData(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    if (vertexSource == VertexSource::TEXTURE) {
+        std::vector<GLint> vertices;
+        vertices.reserve(n * n * 2);
+        for (int z = 0; z < n; z++) {
+            for (int x = 0; x < n; x++) {
+                vertices.push_back(x);
+                vertices.push_back(z);
+            }
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    std::vector<Patch> patches;
+    std::vector<DrawCommand> commands;
+    for (const GridIndices::Patch &p : indices.getPatches()) {
+        patches.push_back({ p.firstIndex, p.count, { 0, 0 }, { p.nodes[0], p.nodes[1], p.nodes[2], p.nodes[3] } });
+        commands.push_back({ p.count, 1, p.firstIndex, p.baseVertex, 0 });
+    }
+    patchCount = patches.size();
+    visiblePatches = patchCount;
+    cullFrame = 0;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, patchBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Patch) * patchCount, patches.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawCommand) * patchCount, commands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
 
-    perlinShader = Shader("./shaders/perlin.comp");
+void WaterMeshChunk::initCulling() {
+    glGenBuffers(1, &patchBuffer);
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(CULL_STATS_FRAMES, visibleCounters);
+    GLuint zero = 0;
+    for (GLuint counter : visibleCounters) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, counter);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    cullShader = Shader("./shaders/cull.comp", { { "WG_SIZE", std::to_string(CULL_WG_SIZE) } });
+    uCullPatchCount = cullShader.getUniform<GLint>("patchCount");
+    uCullCellSize = cullShader.getUniform<GLfloat>("cellSize");
+    uCullMargin = cullShader.getUniform<GLfloat>("margin");
+}
+
+// Sets instanceCount of the draw commands, the frame UBO must be bound
+void WaterMeshChunk::cull() const {
+    GPU_SCOPE("cull");
+
+    // The counter of this slot was written CULL_STATS_FRAMES frames ago, the read rarely waits
+    GLuint counter = visibleCounters[cullFrame % CULL_STATS_FRAMES];
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counter);
+    if (cullFrame >= CULL_STATS_FRAMES) {
+        GLuint visible;
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &visible);
+        visiblePatches = visible;
+    }
+    GLuint zero = 0;
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    cullFrame++;
+
+    int n = vertexSource == VertexSource::TEXTURE ? gridNodes : nodes;
+    cullShader.use();
+    uCullPatchCount.set(patchCount);
+    uCullCellSize.set(size * nodes / n);
+    // A half float map rounds the displacement by up to 2^-11 of its magnitude
+    uCullMargin.set(cullMargin * (getMapFormat() == GL_RGBA16F ? 1.f + 1.f / 1024.f : 1.f));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, patchBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, counter);
+    glDispatchCompute((patchCount + CULL_WG_SIZE - 1) / CULL_WG_SIZE, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
 
-    htShader   = Shader("./shaders/ht.comp");
-    buttShader = Shader("./shaders/butt.comp");
-    fourShader = Shader("./shaders/fourier.comp");
+// RGBA16F with the half precision simulation, the CPU backend always uploads RGBA32F
+void WaterMeshChunk::initDisplacementMap() {
+    glGenTextures(1, &displacementMapID);
+    glBindTexture(GL_TEXTURE_2D, displacementMapID);
+    configGlTexture(GL_REPEAT, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, getMapFormat(), nodes, nodes, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Takes the program variant from the cache, compiles it on the first request
+void WaterMeshChunk::initPrograms() {
+    VariantKey key(nodes, wgSize, precision);
+    auto it = variants.find(key);
+    if (it != variants.end()) {
+        programs = it->second;
+        return;
+    }
+
+    std::map<std::string, std::string> defines = {
+        { "N", std::to_string(nodes) },
+        { "STAGES", std::to_string(fourierStages) },
+        { "WG_SIZE", std::to_string(wgSize) },
+        { "SIM_FORMAT", precision == Precision::HALF ? "rg16f" : "rg32f" },
+        { "MAP_FORMAT", precision == Precision::HALF ? "rgba16f" : "rgba32f" }
+    };
+    programs.ht = Shader("./shaders/ht.comp", defines);
+    programs.fourier = Shader("./shaders/fourier.comp", defines);
+    for (int dir = 0; dir < 2; dir++) {
+        defines["DIR"] = std::to_string(dir);
+        programs.butt[dir] = Shader("./shaders/butt.comp", defines);
+        if (nodes <= FFT_MAX_N)
+            programs.fft[dir] = Shader("./shaders/fft.comp", defines);
+    }
+
+    programs.htL = programs.ht.getUniform<GLfloat>("L");
+    programs.htTime = programs.ht.getUniform<GLfloat>("time");
+    programs.htPackReal = programs.ht.getUniform<bool>("packReal");
+    programs.htSpectralNormals = programs.ht.getUniform<bool>("spectralNormals");
+    programs.fourierPP = programs.fourier.getUniform<GLint>("pp");
+    programs.fourierMeshSize = programs.fourier.getUniform<GLfloat>("meshSize");
+    programs.fourierPackReal = programs.fourier.getUniform<bool>("packReal");
+    programs.fourierSpectralNormals = programs.fourier.getUniform<bool>("spectralNormals");
+    programs.fourierWriteVertices = programs.fourier.getUniform<bool>("writeVertices");
+    for (int dir = 0; dir < 2; dir++) {
+        programs.buttStage[dir] = programs.butt[dir].getUniform<GLint>("stage");
+        programs.buttPP[dir] = programs.butt[dir].getUniform<GLint>("pp");
+        programs.buttChannels[dir] = programs.butt[dir].getUniform<GLint>("channels");
+        if (nodes <= FFT_MAX_N)
+            programs.fftChannels[dir] = programs.fft[dir].getUniform<GLint>("channels");
+    }
+    variants[key] = programs;
+}
+
+// Shaders and textures which depend on the simulation precision
+void WaterMeshChunk::initCompute() {
+    initPrograms();
 
     // Fourier buffer-textures allocation
-    htHTex = generateEmptyTexture(nodes, nodes, GL_FLOAT);
-    htxTex = generateEmptyTexture(nodes, nodes, GL_FLOAT);
-    htzTex = generateEmptyTexture(nodes, nodes, GL_FLOAT);
-    ppTex =  generateEmptyTexture(nodes, nodes, GL_FLOAT);
+    htTex = generateEmptyTextureArray(nodes, nodes, 4, getSimFormat());
+    ppTex = generateEmptyTextureArray(nodes, nodes, 4, getSimFormat());
 
-    // Init debug
-    initDebug();
+    // Height channel of the spectrum as a plain 2D texture, for the debug view
+    glGenTextures(1, &htHView);
+    glTextureView(htHView, GL_TEXTURE_2D, htTex, getSimFormat(), 0, 1, 1, 1);
+    glBindTexture(GL_TEXTURE_2D, htHView);
+    configGlTexture(GL_CLAMP_TO_EDGE, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void WaterMeshChunk::update() {
-    initTextures();
+GLenum WaterMeshChunk::getSimFormat() const {
+    return precision == Precision::HALF ? GL_RG16F : GL_RG32F;
 }
 
-void WaterMeshChunk::show(const glm::mat4 &m_proj_view, bool isMesh, const Camera &cam) const {
-    showShader.use();
+GLenum WaterMeshChunk::getMapFormat() const {
+    return precision == Precision::HALF && backend == Backend::GPU ? GL_RGBA16F : GL_RGBA32F;
+}
 
-    showShader.setUniform("is_mesh", isMesh);
-    if (isMesh)
-        showShader.setUniform("mesh_color", 0.1, 0.1, 0.1);
+void WaterMeshChunk::setSeed(uint seed) {
+    rseed = seed;
+    isSeedFixed = true;
+}
 
-    showShader.setUniform("m_proj_view", m_proj_view);
-    showShader.setUniform("eye_pos", cam.pos);
-    showShader.setUniform("gNodes", nodes * size);
+WaterMeshChunk::~WaterMeshChunk() {
+    delete cpuOcean;
+
+    // Objects of the other backend were never generated, their names are 0 and ignored
+    GLuint buffers[] = { vbo, ebo, gridVBO, patchBuffer, commandBuffer, debugVBO };
+    glDeleteBuffers(6, buffers);
+    glDeleteBuffers(CULL_STATS_FRAMES, visibleCounters);
+    GLuint arrays[] = { vao, gridVAO, debugVAO };
+    glDeleteVertexArrays(3, arrays);
+    GLuint textures[] = { normalMapID, displacementMapID, htHView, htTex, ppTex, h0Tex, buttTex, perlinTex };
+    glDeleteTextures(8, textures);
+}
 
-    showShader.setUniform("globalAmb", globalAmb);
-    showShader.setUniform("skyColor", skyColor);
+void WaterMeshChunk::update() {
+    initTextures();
+}
 
-    showShader.setUniform("sunDir", envSky.getSunDir());
-    showShader.setUniform("sunAngle", envSky.getSunAngle());
-    showShader.setUniform("sunColor", envSky.getSunColor());
+void WaterMeshChunk::bindMaterial() const {
+    material.bind(MATERIAL_UBO_BINDING);
+}
 
-    showShader.setUniform("baseDim", baseDim);
-    showShader.setUniform("baseBright", baseBright);
-    showShader.setUniform("mat.ambient", ambient);
-    showShader.setUniform("mat.diffuse", diffuse);
-    showShader.setUniform("mat.specular", specular);
-    showShader.setUniform("mat.exponent", specExpoenent);
+WaterMeshChunk::ShowUniforms WaterMeshChunk::getShowUniforms(const Shader &shader, bool fromTexture) {
+    ShowUniforms u;
+    u.isMesh = shader.getUniform<bool>("is_mesh");
+    u.meshColor = shader.getUniform<glm::vec3>("mesh_color");
+    u.normalMap = shader.getUniform<GLint>("normalMap");
+    if (fromTexture) {
+        u.displacementMap = shader.getUniform<GLint>("displacementMap");
+        u.nodes = shader.getUniform<GLint>("nodes");
+        u.gridNodes = shader.getUniform<GLint>("gridNodes");
+        u.meshSize = shader.getUniform<GLfloat>("meshSize");
+    }
+    return u;
+}
 
-    showShader.setUniform("normalMap", 0);
-    showShader.setUniform("perlinNoise", 1);
+void WaterMeshChunk::show(const FrameUniforms &frame, bool isMesh) const {
+    GPU_SCOPE("water");
+    frame.bind(FRAME_UBO_BINDING);
+    material.bind(MATERIAL_UBO_BINDING);
+    if (culling)
+        cull();
+
+    bool fromTexture = vertexSource == VertexSource::TEXTURE;
+    const Shader &shader = fromTexture ? gridShader : showShader;
+    const ShowUniforms &u = fromTexture ? gridUniforms : showUniforms;
+    shader.use();
+    u.isMesh.set(isMesh);
+    if (isMesh)
+        u.meshColor.set(glm::vec3(0.1f));
+
+    u.normalMap.set(0);
+    if (fromTexture) {
+        u.displacementMap.set(2);
+        u.nodes.set(nodes);
+        u.gridNodes.set(gridNodes);
+        u.meshSize.set(size);
+    }
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, normalMapID);
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, perlinTex);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, displacementMapID);
+    glActiveTexture(GL_TEXTURE0);
 
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
@@ -148,8 +347,14 @@ void WaterMeshChunk::show(const glm::mat4 &m_proj_view, bool isMesh, const Camer
     else
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, elementsCount, GL_UNSIGNED_INT, nullptr);
+    // Patches have their own baseVertex, so the whole chunk is drawn by the commands even without culling
+    glBindVertexArray(fromTexture ? gridVAO : vao);
+    if (indexMode == GL_TRIANGLE_STRIP)
+        glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(indexMode, indexType, nullptr, patchCount, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
 
     glBindVertexArray(0);
 
@@ -157,8 +362,27 @@ void WaterMeshChunk::show(const glm::mat4 &m_proj_view, bool isMesh, const Camer
 }
 
 void WaterMeshChunk::initTextures() {
-    buttTex = generateButterflyTexture(nodes);
-    h0Tex = generateH0Texture();
+    if (backend == Backend::CPU) {
+        GLfloat *h0 = generateH0();
+        cpuOcean->setSpectrum(h0);
+        perlinTex = 0;
+        delete[] h0;
+        return;
+    }
+
+    // Tables of a previous update are replaced
+    GLuint tables[] = { buttTex, h0Tex, perlinTex };
+    glDeleteTextures(3, tables);
+
+    // Both tables are built on the CPU while the driver is still compiling the programs
+    std::future<GLfloat*> butterfly = std::async(std::launch::async, &WaterMeshChunk::generateButterfly, this, nodes);
+    GLfloat *h0 = generateH0();
+    GLfloat *butt = butterfly.get();
+
+    buttTex = generateButterflyTexture(butt, nodes);
+    h0Tex = generateH0Texture(h0);
+    delete[] butt;
+    delete[] h0;
 
     int perlinTexSize = 256;
     perlinTex = generateEmptyTexture(perlinTexSize, perlinTexSize, GL_FLOAT);
@@ -169,69 +393,108 @@ void WaterMeshChunk::initTextures() {
 }
 
 void WaterMeshChunk::computePhysics(float time) const {
-    htShader.use();
-    htShader.setUniform("L", nodes * size);
-    htShader.setUniform("N", nodes);
-    htShader.setUniform("time", time);
-    glBindImageTexture(0, h0Tex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-    glBindImageTexture(1, htHTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glBindImageTexture(2, htxTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glBindImageTexture(3, htzTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glDispatchCompute(nodes / WG_SIZE, nodes / WG_SIZE, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
+    if (backend == Backend::CPU) {
+        cpuOcean->compute(time);
+        GPU_SCOPE("upload");
+        if (vertexSource == VertexSource::BUFFER) {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * nodes * nodes * 3, cpuOcean->getVertices());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glBindTexture(GL_TEXTURE_2D, normalMapID);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, nodes, nodes, GL_RGBA, GL_FLOAT, cpuOcean->getNormals());
+        glBindTexture(GL_TEXTURE_2D, displacementMapID);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, nodes, nodes, GL_RGB, GL_FLOAT, cpuOcean->getDisplacement());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return;
+    }
+
+    {
+        GPU_SCOPE("ht");
+        programs.ht.use();
+        programs.htL.set(nodes * size);
+        programs.htTime.set(time);
+        programs.htPackReal.set(realTransform);
+        programs.htSpectralNormals.set(spectralNormals);
+        glBindImageTexture(0, h0Tex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, htTex, 0, GL_TRUE, 0, GL_WRITE_ONLY, getSimFormat());
+        glDispatchCompute(nodes / wgSize, nodes / wgSize, 1);
+        glMemoryBarrier(GL_ALL_BARRIER_BITS);
+    }
+
+    ifft();
+}
 
-    ifft(htxTex, 0);
-    ifft(htHTex, 1);
-    ifft(htzTex, 2);
+// Transforms all channels of htTex together and writes the displacement map and, with
+// VertexSource::BUFFER, the VBO. Normals and the Jacobian go to the normal map in the same pass
+void WaterMeshChunk::ifft() const {
+    int pp;
+    {
+        GPU_SCOPE("fft");
+        if (fftMode == FFTMode::SHARED)
+            pp = ifftShared();
+        else
+            pp = ifftButterfly();
+    }
 
-    normShader.use();
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vbo);
-    glBindImageTexture(1, normalMapID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glDispatchCompute(nodes / WG_SIZE, nodes / WG_SIZE, 1);
+    GPU_SCOPE("fourier");
+    programs.fourier.use();
+    programs.fourierPP.set(pp);
+    programs.fourierMeshSize.set(size);
+    programs.fourierPackReal.set(realTransform);
+    programs.fourierSpectralNormals.set(realTransform && spectralNormals);
+    programs.fourierWriteVertices.set(vertexSource == VertexSource::BUFFER);
+    glBindImageTexture(0, htTex, 0, GL_TRUE, 0, GL_READ_ONLY, getSimFormat());
+    glBindImageTexture(1, ppTex, 0, GL_TRUE, 0, GL_READ_ONLY, getSimFormat());
+    glBindImageTexture(2, normalMapID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(3, displacementMapID, 0, GL_FALSE, 0, GL_WRITE_ONLY, getMapFormat());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vbo);
+    glDispatchCompute(nodes / wgSize, nodes / wgSize, 1);
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
 }
 
-void WaterMeshChunk::ifft(GLuint src, int bPos) const {
+// Returns ping-pong index of the texture which holds the result
+int WaterMeshChunk::ifftButterfly() const {
     GLenum barrier = GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
 
-    int pp = 0;
-    buttShader.use();
-    buttShader.setUniform("dir", (int)0);
     glBindImageTexture(0, buttTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-    glBindImageTexture(1, src, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
-    glBindImageTexture(2, ppTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
-    for (int i = 0; i < fourierStages; i++) {
-        buttShader.setUniform("stage", i);
-        buttShader.setUniform("pp", pp);
-        glDispatchCompute(nodes / WG_SIZE, nodes / WG_SIZE, 1);
-        glMemoryBarrier(barrier);
-        pp = 1 - pp;
-    }
-    buttShader.setUniform("dir", (int)1);
-    for (int i = 0; i < fourierStages; i++) {
-        buttShader.setUniform("stage", i);
-        buttShader.setUniform("pp", pp);
-        glDispatchCompute(nodes / WG_SIZE, nodes / WG_SIZE, 1);
-        glMemoryBarrier(barrier);
-        pp = 1 - pp;
+    glBindImageTexture(1, htTex, 0, GL_TRUE, 0, GL_READ_WRITE, getSimFormat());
+    glBindImageTexture(2, ppTex, 0, GL_TRUE, 0, GL_READ_WRITE, getSimFormat());
+
+    int pp = 0;
+    for (int dir = 0; dir < 2; dir++) {
+        programs.butt[dir].use();
+        programs.buttChannels[dir].set(fftChannels);
+        for (int i = 0; i < fourierStages; i++) {
+            programs.buttStage[dir].set(i);
+            programs.buttPP[dir].set(pp);
+            glDispatchCompute(nodes / wgSize, nodes / wgSize, 1);
+            glMemoryBarrier(barrier);
+            pp = 1 - pp;
+        }
     }
+    return pp;
+}
 
-    fourShader.use();
-    fourShader.setUniform("pp", pp);
-    fourShader.setUniform("N", nodes);
-    fourShader.setUniform("buffPos", bPos);
-    fourShader.setUniform("meshSize", size);
-    glBindImageTexture(0, src, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-    glBindImageTexture(1, ppTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vbo);
-    glDispatchCompute(nodes / WG_SIZE, nodes / WG_SIZE, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
+// Transforms htTex in-place, one workgroup per row and then per column
+int WaterMeshChunk::ifftShared() const {
+    glBindImageTexture(0, buttTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, htTex, 0, GL_TRUE, 0, GL_READ_WRITE, getSimFormat());
+
+    for (int dir = 0; dir < 2; dir++) {
+        programs.fft[dir].use();
+        programs.fftChannels[dir].set(fftChannels);
+        glDispatchCompute(nodes, 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    return 0;
 }
 
 // Debug
 
 void WaterMeshChunk::initDebug() {
     txShader = Shader("./shaders/tx.vert", "./shaders/tx.frag");
+
     GLfloat vertices[18][4] = {
         { 0, 300, 0, 1 }, { 0, 0,   0, 0 }, { 300, 0,   1, 0 },
         { 0, 300, 0, 1 }, { 300, 0, 1, 0 }, { 300, 300, 1, 1 },
@@ -251,26 +514,28 @@ void WaterMeshChunk::initDebug() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void WaterMeshChunk::showDebugImage(const glm::mat4 &m_ortho, float time) const {
-    htShader.use();
-    htShader.setUniform("L", nodes * size);
-    htShader.setUniform("N", nodes);
-    htShader.setUniform("time", time);
+void WaterMeshChunk::showDebugImage(const FrameUniforms &frame, float time) const {
+    if (backend != Backend::GPU)
+        return;
+
+    programs.ht.use();
+    programs.ht.setUniform("L", nodes * size);
+    programs.ht.setUniform("time", time);
+    programs.ht.setUniform("packReal", realTransform);
+    programs.ht.setUniform("spectralNormals", spectralNormals);
     glBindImageTexture(0, h0Tex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-    glBindImageTexture(1, htHTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glBindImageTexture(2, htxTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glBindImageTexture(3, htzTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glDispatchCompute(nodes / WG_SIZE, nodes / WG_SIZE, 1);
+    glBindImageTexture(1, htTex, 0, GL_TRUE, 0, GL_WRITE_ONLY, getSimFormat());
+    glDispatchCompute(nodes / wgSize, nodes / wgSize, 1);
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
     txShader.use();
-    txShader.setUniform("projection", m_ortho);
+    frame.bind(FRAME_UBO_BINDING);
     txShader.setUniform("tex", 0);
     glBindVertexArray(debugVAO);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, perlinTex);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindTexture(GL_TEXTURE_2D, htHTex);
+    glBindTexture(GL_TEXTURE_2D, htHView);
     glDrawArrays(GL_TRIANGLES, 6, 6);
     glBindVertexArray(0);
 }
@@ -299,7 +564,21 @@ GLuint WaterMeshChunk::generateEmptyTexture(int width, int height, GLenum type)
     return id;
 }
 
-GLuint WaterMeshChunk::generateButterflyTexture(int N) const {
+GLuint WaterMeshChunk::generateEmptyTextureArray(int width, int height, int layers, GLenum format) const {
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, format, width, height, layers);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return id;
+}
+
+// Returns RGBA per stage and index: twiddle factor and input indices
+GLfloat* WaterMeshChunk::generateButterfly(int N) const {
     int logN = log2i(N);
     GLfloat *buff = new GLfloat[N * logN * 4];
 
@@ -333,20 +612,21 @@ GLuint WaterMeshChunk::generateButterflyTexture(int N) const {
             }
         }
     }
+    return buff;
+}
 
+GLuint WaterMeshChunk::generateButterflyTexture(const GLfloat *butterfly, int N) const {
     GLuint id;
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
     configGlTexture(GL_CLAMP_TO_EDGE, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, logN, N, 0, GL_RGBA, GL_FLOAT, buff);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, log2i(N), N, 0, GL_RGBA, GL_FLOAT, butterfly);
     glBindTexture(GL_TEXTURE_2D, 0);
-
-    delete[] buff;
     return id;
 }
 
-GLuint WaterMeshChunk::generateH0Texture() const {
-    GLuint id;
+// Returns RGBA per node: h0(k) and conj(h0(-k))
+GLfloat* WaterMeshChunk::generateH0() const {
     GLfloat *buff = new GLfloat[nodes * nodes * 4];
 
     float Lnodes = nodes * size;
@@ -372,17 +652,28 @@ GLuint WaterMeshChunk::generateH0Texture() const {
             int base = ((z * nodes) + x) * 4;
             buff[base + 0] = rnd[0] * h0;
             buff[base + 1] = rnd[1] * h0;
-            buff[base + 2] = rnd[2] * h0;
-            buff[base + 3] = rnd[3] * h0 * -1.f; // conj
         }
     }
 
+    // conj(h0(-k)) makes h(k, t) Hermitian, so the displacement is real
+    for (int z = 0; z < nodes; z++) {
+        for (int x = 0; x < nodes; x++) {
+            int base = ((z * nodes) + x) * 4;
+            int mirror = ((((nodes - z) % nodes) * nodes) + (nodes - x) % nodes) * 4;
+            buff[base + 2] = buff[mirror + 0];
+            buff[base + 3] = buff[mirror + 1] * -1.f; // conj
+        }
+    }
+    return buff;
+}
+
+GLuint WaterMeshChunk::generateH0Texture(const GLfloat *h0) const {
+    GLuint id;
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
     configGlTexture(GL_CLAMP_TO_EDGE, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, nodes, nodes, 0, GL_RGBA, GL_FLOAT, buff);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, nodes, nodes, 0, GL_RGBA, GL_FLOAT, h0);
     glBindTexture(GL_TEXTURE_2D, 0);
-    delete[] buff;
     return id;
 }
 
@@ -392,6 +683,115 @@ void WaterMeshChunk::setAmplitude(float amp) {
     this->amplitude = amp;
 }
 
+void WaterMeshChunk::setFFTMode(FFTMode mode) {
+    if (mode == FFTMode::SHARED && nodes > FFT_MAX_N) {
+        std::cerr << "Shared FFT supports up to " << FFT_MAX_N << " nodes" << std::endl;
+        return;
+    }
+    this->fftMode = mode;
+}
+
+// Packs dx + i * dz into one transform, which is exact for the Hermitian spectrum.
+// The result matches the unpacked path up to float rounding: vertices differ by
+// at most one ulp of their coordinate, i.e. < 6e-6 of the largest displacement
+// for N <= 1024 in both FFT modes.
+void WaterMeshChunk::setRealTransform(bool packed) {
+    this->realTransform = packed;
+    updateChannels();
+}
+
+// Normals from the transformed slope spectrum instead of finite differences.
+// Needs the real transform: the slopes go into its free imaginary halves, two more
+// layers per transform. Only the GPU backend supports them.
+void WaterMeshChunk::setSpectralNormals(bool spectral) {
+    if (spectral && !realTransform) {
+        std::cerr << "Spectral normals need the real transform" << std::endl;
+        return;
+    }
+    this->spectralNormals = spectral;
+    updateChannels();
+}
+
+void WaterMeshChunk::setCulling(bool enabled) {
+    if (culling == enabled)
+        return;
+    culling = enabled;
+    initGrid();
+}
+
+void WaterMeshChunk::setCullMargin(float margin) {
+    cullMargin = margin;
+}
+
+void WaterMeshChunk::setIndexLayout(GridIndices::Layout layout, bool shortIndices) {
+    if (layout == indexLayout && shortIndices == this->shortIndices)
+        return;
+    indexLayout = layout;
+    this->shortIndices = shortIndices;
+    initGrid();
+}
+
+// Half precision is the fast mode: displacement error is ~0.15% of the wave height
+// with the shared FFT and ~0.5% with butterflies. GPU backend only.
+void WaterMeshChunk::setPrecision(Precision precision) {
+    if (precision == this->precision)
+        return;
+    this->precision = precision;
+    if (backend != Backend::GPU)
+        return;
+
+    // Programs stay in the variant cache
+    GLuint textures[] = { htHView, htTex, ppTex, displacementMapID };
+    glDeleteTextures(4, textures);
+    initCompute();
+    initDisplacementMap();
+}
+
+void WaterMeshChunk::setVertexSource(VertexSource source) {
+    if (source == vertexSource)
+        return;
+    vertexSource = source;
+    initGrid();
+}
+
+void WaterMeshChunk::setGridNodes(int n) {
+    if (n < CULL_PATCH_CELLS) {
+        std::cerr << "Bad grid size " << n << ", at least " << CULL_PATCH_CELLS << " nodes" << std::endl;
+        return;
+    }
+    if (n == gridNodes)
+        return;
+    gridNodes = n;
+    if (vertexSource == VertexSource::TEXTURE)
+        initGrid();
+}
+
+// Side of the square workgroup of the per-texel passes, a power of two dividing the grid
+void WaterMeshChunk::setWorkGroupSize(int size) {
+    if (size <= 0 || (size & (size - 1)) != 0 || nodes % size != 0 || size * size > MAX_WG_INVOCATIONS) {
+        std::cerr << "Bad workgroup size " << size << " for " << nodes << " nodes" << std::endl;
+        return;
+    }
+    if (size == wgSize)
+        return;
+    this->wgSize = size;
+    if (backend == Backend::GPU)
+        initPrograms();
+}
+
+void WaterMeshChunk::updateChannels() {
+    if (realTransform)
+        this->fftChannels = spectralNormals ? 4 : 2;
+    else
+        this->fftChannels = 3;
+}
+
+// Worker threads of the CPU backend, <= 0 - one per hardware thread
+void WaterMeshChunk::setThreadCount(int threads) {
+    if (cpuOcean)
+        cpuOcean->setThreadCount(threads);
+}
+
 void WaterMeshChunk::setWind(const glm::vec3 &dir, float speed) {
     this->windDir = glm::normalize(dir);
     this->windSpeed = speed;
@@ -399,6 +799,8 @@ void WaterMeshChunk::setWind(const glm::vec3 &dir, float speed) {
 
 void WaterMeshChunk::setSky(const EnvSky &sky) {
     this->envSky = sky;
+    material.getData().sunDir = sky.getSunDir();
+    material.upload();
 }
 
 void WaterMeshChunk::setGlobalAmbient(const glm::vec3 &color) {
@@ -406,25 +808,30 @@ void WaterMeshChunk::setGlobalAmbient(const glm::vec3 &color) {
 }
 
 void WaterMeshChunk::setDiffuse(const glm::vec3 &color) {
-    this->ambient = color;
+    material.getData().ambient = color;
+    material.upload();
 }
 
 void WaterMeshChunk::setAmbient(const glm::vec3 &color) {
-    this->diffuse = color;
+    material.getData().diffuse = color;
+    material.upload();
 }
 
 void WaterMeshChunk::setSpecular(const glm::vec3 &color, float exp) {
-    this->specular = color;
-    this->specExpoenent = exp;
+    material.getData().specular = color;
+    material.getData().exponent = exp;
+    material.upload();
 }
 
 void WaterMeshChunk::setSkyColor(const glm::vec3 &color) {
-    this->skyColor = color;
+    material.getData().skyColor = color;
+    material.upload();
 }
 
 void WaterMeshChunk::setBaseColor(const glm::vec3 &dim, const glm::vec3 &bright) {
-    this->baseDim = dim;
-    this->baseBright = bright;
+    material.getData().baseDim = dim;
+    material.getData().baseBright = bright;
+    material.upload();
 }
 
 
@@ -443,3 +850,67 @@ float WaterMeshChunk::getSize() const {
 glm::vec3 WaterMeshChunk::getOffset() const {
     return offset;
 }
+
+WaterMeshChunk::Backend WaterMeshChunk::getBackend() const {
+    return backend;
+}
+
+WaterMeshChunk::FFTMode WaterMeshChunk::getFFTMode() const {
+    return fftMode;
+}
+
+bool WaterMeshChunk::isRealTransform() const {
+    return realTransform;
+}
+
+bool WaterMeshChunk::isSpectralNormals() const {
+    return spectralNormals;
+}
+
+bool WaterMeshChunk::isCulling() const {
+    return culling;
+}
+
+int WaterMeshChunk::getPatchCount() const {
+    return patchCount;
+}
+
+int WaterMeshChunk::getVisiblePatches() const {
+    return visiblePatches;
+}
+
+WaterMeshChunk::VertexSource WaterMeshChunk::getVertexSource() const {
+    return vertexSource;
+}
+
+int WaterMeshChunk::getGridNodes() const {
+    return gridNodes;
+}
+
+GridIndices::Layout WaterMeshChunk::getIndexLayout() const {
+    return indexLayout;
+}
+
+bool WaterMeshChunk::isShortIndices() const {
+    return indexType == GL_UNSIGNED_SHORT;
+}
+
+WaterMeshChunk::Precision WaterMeshChunk::getPrecision() const {
+    return precision;
+}
+
+int WaterMeshChunk::getWorkGroupSize() const {
+    return wgSize;
+}
+
+int WaterMeshChunk::getThreadCount() const {
+    return cpuOcean ? cpuOcean->getThreadCount() : 0;
+}
+
+GLuint WaterMeshChunk::getNormalMap() const {
+    return normalMapID;
+}
+
+GLuint WaterMeshChunk::getDisplacementMap() const {
+    return displacementMapID;
+}
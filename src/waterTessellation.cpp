@@ -0,0 +1,121 @@
+#include "../include/waterTessellation.hpp"
+#include "../include/util/gpuProfiler.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+WaterTessellation::WaterTessellation(int patches, float patchSize) {
+    assert(patches > 0 && patches % 2 == 0);
+
+    this->patches = patches;
+    this->patchSize = patchSize;
+    glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+
+    int side = patches + 1;
+    std::vector<GLint> vertices;
+    vertices.reserve(side * side * 2);
+    for (int z = 0; z < side; z++) {
+        for (int x = 0; x < side; x++) {
+            vertices.push_back(x);
+            vertices.push_back(z);
+        }
+    }
+
+    // Corners of a patch in the order of tess.tesc
+    std::vector<GLuint> indices;
+    indices.reserve(patches * patches * 4);
+    for (int z = 0; z < patches; z++) {
+        for (int x = 0; x < patches; x++) {
+            GLuint v = z * side + x;
+            indices.push_back(v);
+            indices.push_back(v + 1);
+            indices.push_back(v + side + 1);
+            indices.push_back(v + side);
+        }
+    }
+    indexCount = indices.size();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 2, GL_INT, 2 * sizeof(GLint), 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glGenSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    shader = Shader("./shaders/tess.vert", "./shaders/tess.tesc", "./shaders/tess.tese", "./shaders/water.frag");
+}
+
+void WaterTessellation::show(const FrameUniforms &frame, const WaterMeshChunk &water, bool isMesh) const {
+    GPU_SCOPE("tessellation");
+
+    // Distant triangles read the maps through mipmaps
+    GLuint maps[] = { water.getNormalMap(), water.getDisplacementMap() };
+    for (GLuint map : maps) {
+        glBindTexture(GL_TEXTURE_2D, map);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    shader.use();
+    frame.bind(FRAME_UBO_BINDING);
+    water.bindMaterial();
+
+    shader.setUniform("is_mesh", isMesh);
+    if (isMesh)
+        shader.setUniform("mesh_color", 0.1, 0.1, 0.1);
+    shader.setUniform("normalMap", 0);
+    shader.setUniform("displacementMap", 2);
+    shader.setUniform("patchSize", patchSize);
+    shader.setUniform("edgePixels", edgePixels);
+    shader.setUniform("maxLevel", (GLfloat) maxLevel);
+
+    // The grid moves by whole patches, so tessellation of a patch does not swim
+    const glm::vec4 &eye = frame.getData().eye;
+    shader.getUniform<glm::ivec2>("origin").set(glm::ivec2(
+        (int) std::floor(eye.x / patchSize) - patches / 2,
+        (int) std::floor(eye.z / patchSize) - patches / 2));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, water.getNormalMap());
+    glBindSampler(0, sampler);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, water.getDisplacementMap());
+    glBindSampler(2, sampler);
+    glActiveTexture(GL_TEXTURE0);
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glPolygonMode(GL_FRONT_AND_BACK, isMesh ? GL_LINE : GL_FILL);
+
+    glPatchParameteri(GL_PATCH_VERTICES, 4);
+    glBindVertexArray(vao);
+    glDrawElements(GL_PATCHES, indexCount, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+
+    glBindSampler(0, 0);
+    glBindSampler(2, 0);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+void WaterTessellation::setEdgePixels(float pixels) {
+    this->edgePixels = pixels;
+}
+
+float WaterTessellation::getRange() const {
+    return patches / 2 * patchSize;
+}
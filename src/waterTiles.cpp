@@ -0,0 +1,178 @@
+#include "../include/waterTiles.hpp"
+#include "../include/util/gpuProfiler.hpp"
+
+#include <cassert>
+#include <cmath>
+
+// Planes of the view frustum from the rows of projView, normals point inside
+static void getFrustumPlanes(const glm::mat4 &m, glm::vec4 planes[6]) {
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = rows[3] + rows[i];
+        planes[2 * i + 1] = rows[3] - rows[i];
+    }
+}
+
+// False when the box is entirely behind one of the planes
+static bool isBoxVisible(const glm::vec4 planes[6], const glm::vec3 &lo, const glm::vec3 &hi) {
+    for (int i = 0; i < 6; i++) {
+        const glm::vec4 &p = planes[i];
+        glm::vec3 far(p.x >= 0.f ? hi.x : lo.x, p.y >= 0.f ? hi.y : lo.y, p.z >= 0.f ? hi.z : lo.z);
+        if (glm::dot(glm::vec3(p), far) + p.w < 0.f)
+            return false;
+    }
+    return true;
+}
+
+WaterTiles::WaterTiles(const WaterMeshChunk &water, int radius, float margin) {
+    assert(radius >= 0);
+
+    this->nodes = water.getWidth();
+    this->radius = radius;
+    this->margin = margin;
+
+    // One period of the simulation, the last row and column repeat the first ones
+    int side = nodes + 1;
+    std::vector<GLint> vertices;
+    vertices.reserve(side * side * 2);
+    for (int z = 0; z < side; z++) {
+        for (int x = 0; x < side; x++) {
+            vertices.push_back(x);
+            vertices.push_back(z);
+        }
+    }
+
+    std::vector<GLuint> indices;
+    indices.reserve(nodes * nodes * 6);
+    for (int z = 0; z < nodes; z++) {
+        for (int x = 0; x < nodes; x++) {
+            GLuint v = z * side + x;
+            indices.push_back(v);
+            indices.push_back(v + 1);
+            indices.push_back(v + side + 1);
+            indices.push_back(v);
+            indices.push_back(v + side + 1);
+            indices.push_back(v + side);
+        }
+    }
+    indexCount = indices.size();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glGenBuffers(1, &instanceVBO);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 2, GL_INT, 2 * sizeof(GLint), 0);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 2, GL_INT, 2 * sizeof(GLint), 0);
+    glVertexAttribDivisor(1, 1);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glGenSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    shader = Shader("./shaders/tile.vert", "./shaders/water.frag");
+}
+
+void WaterTiles::show(const FrameUniforms &frame, const WaterMeshChunk &water, bool isMesh) const {
+    GPU_SCOPE("tiles");
+
+    const glm::mat4 &projView = frame.getData().projView;
+    const glm::vec4 &eye = frame.getData().eye;
+    glm::vec3 origin = water.getOffset();
+    float tileSize = nodes * water.getSize();
+    int eyeX = (int) std::floor((eye.x - origin.x) / tileSize);
+    int eyeZ = (int) std::floor((eye.z - origin.z) / tileSize);
+
+    glm::vec4 planes[6];
+    getFrustumPlanes(projView, planes);
+    visible.clear();
+    for (int z = eyeZ - radius; z <= eyeZ + radius; z++) {
+        for (int x = eyeX - radius; x <= eyeX + radius; x++) {
+            glm::vec3 lo = origin + glm::vec3(x * tileSize - margin, -margin, z * tileSize - margin);
+            glm::vec3 hi = lo + glm::vec3(tileSize + 2.f * margin, 2.f * margin, tileSize + 2.f * margin);
+            if (culling && !isBoxVisible(planes, lo, hi))
+                continue;
+            visible.push_back(x);
+            visible.push_back(z);
+        }
+    }
+    if (visible.empty())
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * visible.size(), visible.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    shader.use();
+    frame.bind(FRAME_UBO_BINDING);
+    water.bindMaterial();
+
+    shader.setUniform("is_mesh", isMesh);
+    if (isMesh)
+        shader.setUniform("mesh_color", 0.1, 0.1, 0.1);
+    shader.setUniform("normalMap", 0);
+    shader.setUniform("displacementMap", 2);
+    shader.setUniform("nodes", nodes);
+    shader.setUniform("origin", glm::vec2(origin.x, origin.z));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, water.getNormalMap());
+    glBindSampler(0, sampler);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, water.getDisplacementMap());
+    glBindSampler(2, sampler);
+    glActiveTexture(GL_TEXTURE0);
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glPolygonMode(GL_FRONT_AND_BACK, isMesh ? GL_LINE : GL_FILL);
+
+    glBindVertexArray(vao);
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, visible.size() / 2);
+    glBindVertexArray(0);
+
+    glBindSampler(0, 0);
+    glBindSampler(2, 0);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+void WaterTiles::setRadius(int radius) {
+    assert(radius >= 0);
+    this->radius = radius;
+}
+
+void WaterTiles::setCulling(bool enabled) {
+    culling = enabled;
+}
+
+float WaterTiles::getRange(const WaterMeshChunk &water) const {
+    return (radius + 1) * nodes * water.getSize();
+}
+
+int WaterTiles::getTileCount() const {
+    return (2 * radius + 1) * (2 * radius + 1);
+}
+
+int WaterTiles::getVisibleTiles() const {
+    return visible.size() / 2;
+}
+
+int WaterTiles::getVertexCount() const {
+    return (nodes + 1) * (nodes + 1);
+}